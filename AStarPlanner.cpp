@@ -1,7 +1,9 @@
 #include "AStarPlanner.h"
-#include <algorithm> // reverse
 #include <iostream>
 
+constexpr int AStarNodes::MAX_CONFLICTS;
+constexpr int AStarNodes::MAX_H;
+
 ostream& operator<<(ostream& os, const Constraint& constraint){
     os << "Constraint ( " 
        << getAgentId(constraint) << ", "
@@ -19,14 +21,3 @@ ostream& operator<<(ostream& os, const Path& path)
     }
     return os;
 }
-
-Path AStarPlanner::make_path(const AStarNode* goal_node) const {
-    Path path;
-    const AStarNode* curr = goal_node;
-    while (curr != nullptr) {
-        path.push_back(curr->location);
-        curr = curr->parent;
-    }
-    std::reverse(path.begin(),path.end());
-    return path;
-}
\ No newline at end of file
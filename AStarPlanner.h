@@ -1,17 +1,25 @@
 #pragma once
 #include "MAPFInstance.h"
+#include "StateTable.h"
+#include "OpenList.h"
 #include <ostream>
 #include <queue>
 #include <unordered_map>
 #include <unordered_set>
+#include <map>
 #include <iostream>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
 
 constexpr int VERTEX_CONSTRAINT = -1;
+constexpr int POSITIVE_VERTEX_CONSTRAINT = -2;
+constexpr int LENGTH_CONSTRAINT = -3;
 constexpr int ALL_FUTURE_TIMESTEPS = -1;
 
 
 template <typename T>
-T atOrBack(vector<T> vec, size_t index) {
+inline const T& atOrBack(const vector<T>& vec, size_t index) {
     return index < vec.size() ? vec[index] : vec.back();
 }
 
@@ -19,12 +27,21 @@ T atOrBack(vector<T> vec, size_t index) {
 // that prohibits agent a from being at location x at timestep t
 // Edge constraint <a, x, y, t>
 // that prohibits agent a from moving from locations x to y from timesteps t-1 to t
+// Positive vertex constraint <a, x, -2, t>
+// that requires agent a to be at location x at timestep t
+// (with timestep -t: at every timestep from t on, so x must be its goal)
+// Length constraint <a, g, -3, t>
+// that prohibits agent a from finishing at its goal g at or before timestep t
 typedef tuple<int, int, int, int > Constraint;
 inline int getAgentId(const Constraint & constraint) { return get<0>(constraint); }
 inline int getFirstLocation(const Constraint & constraint) { return get<1>(constraint); }
 inline int getSecondLocation(const Constraint & constraint) { return get<2>(constraint); }
 inline int isVertexConstraint(const Constraint & constraint) 
     { return getSecondLocation(constraint) == VERTEX_CONSTRAINT; }
+inline bool isPositiveConstraint(const Constraint & constraint)
+    { return getSecondLocation(constraint) == POSITIVE_VERTEX_CONSTRAINT; }
+inline bool isLengthConstraint(const Constraint & constraint)
+    { return getSecondLocation(constraint) == LENGTH_CONSTRAINT; }
 inline int getTimestep(const Constraint & constraint) { return get<3>(constraint); }
 inline bool allRemainingTimesteps(const Constraint & constraint)
     { return getTimestep(constraint) < 0; }
@@ -45,176 +62,401 @@ inline bool operator<(const Constraint& lhs, const Constraint& rhs) {
 typedef vector<int> Path;
 ostream& operator<<(ostream& os, const Path& path); // used for printing paths
 
-// A hash function used to hash a pair of any kind
-// This will be used in Task 1 when you try to
-// use pair as the key of an unordered_map
-struct hash_pair {
-    template <class T1, class T2>
-    size_t operator()(const pair<T1, T2>& p) const
+// Hashes the four fields of a constraint with a 64-bit mix so that
+// constraints differing only in field order do not collide.
+struct hash_constraint {
+    size_t operator()(const Constraint& c) const
     {
-        auto hash1 = hash<T1>{}(p.first);
-        auto hash2 = hash<T2>{}(p.second);
-        return hash1 ^ hash2;
+        uint64_t key = (uint64_t)(uint32_t)getAgentId(c);
+        key = key * 0x9E3779B97F4A7C15ULL + (uint32_t)getFirstLocation(c);
+        key = key * 0x9E3779B97F4A7C15ULL + (uint32_t)getSecondLocation(c);
+        key = key * 0x9E3779B97F4A7C15ULL + (uint32_t)getTimestep(c);
+        return key ^ (key >> 31);
     }
 };
 
-struct AStarNode {
-    int location;
-    int g;
-    int h;
-    int timestep;
-    AStarNode* parent;
+// Constraints of one agent indexed for O(1) lookup during the low-level search.
+// Vertex and edge constraints are kept apart, and constraints that hold for all
+// remaining timesteps are stored with timestep 0 and mapped to their first timestep.
+// Positive constraints are kept as waypoints: at their timestep, every other location is prohibited.
+class ConstraintTable {
+public:
+    template <class Iterator>
+    void build(int agent_id, int goal_location, Iterator constraints_begin, Iterator constraints_end) {
+        this->agent_id = agent_id;
+        this->goal_location = goal_location;
+        vertex.clear();
+        edge.clear();
+        future.clear();
+        waypoints.clear();
+        settle_timestep = INT_MAX;
+        latest_goal_timestep = -1;
+        last_timestep = 0;
+
+        for (auto it = constraints_begin; it != constraints_end; ++it) {
+            const Constraint& constraint = *it;
+            if (getAgentId(constraint) != agent_id)
+                continue;
+            last_timestep = max(last_timestep, abs(getTimestep(constraint)));
+
+            if (isPositiveConstraint(constraint) && allRemainingTimesteps(constraint)) {
+                settle_timestep = min(settle_timestep, -getTimestep(constraint));
+                waypoints[-getTimestep(constraint)] = getFirstLocation(constraint);
+                if (getFirstLocation(constraint) != goal_location)
+                    latest_goal_timestep = INT_MAX; // it could never stop at its goal
+            } else if (isPositiveConstraint(constraint)) {
+                waypoints[getTimestep(constraint)] = getFirstLocation(constraint);
+                if (getFirstLocation(constraint) != goal_location)
+                    latest_goal_timestep = max(latest_goal_timestep, getTimestep(constraint));
+            } else if (isLengthConstraint(constraint)) {
+                latest_goal_timestep = max(latest_goal_timestep, getTimestep(constraint));
+            } else if (allRemainingTimesteps(constraint)) {
+                Constraint key(agent_id, getFirstLocation(constraint), getSecondLocation(constraint), 0);
+                auto found = future.find(key);
+                if (found == future.end() || found->second > -getTimestep(constraint))
+                    future[key] = -getTimestep(constraint);
+                if (isVertexConstraint(constraint) && getFirstLocation(constraint) == goal_location)
+                    latest_goal_timestep = INT_MAX; // the goal is never free for good
+            } else {
+                (isVertexConstraint(constraint) ? vertex : edge).insert(constraint);
+                if (isVertexConstraint(constraint) && getFirstLocation(constraint) == goal_location)
+                    latest_goal_timestep = max(latest_goal_timestep, getTimestep(constraint));
+            }
+        }
+    }
 
-    AStarNode(): location(-1), g(-1), h(-1), timestep(-1), parent(nullptr) {}
-    AStarNode(int location, int g, int h, int timestep, AStarNode* parent):
-            location(location), g(g), h(h), timestep(timestep), parent(parent) {}
+    // true iff moving from curr_location to next_location, arriving at timestep, is prohibited
+    inline bool is_constrained(int curr_location, int next_location, int timestep) const {
+        if (!vertex.empty() && vertex.count(Constraint(agent_id, next_location, VERTEX_CONSTRAINT, timestep)))
+            return true;
+        if (!edge.empty() && edge.count(Constraint(agent_id, curr_location, next_location, timestep)))
+            return true;
+        if (!waypoints.empty()) {
+            auto it = waypoints.find(timestep);
+            if (it != waypoints.end() && it->second != next_location)
+                return true;
+            if (timestep >= settle_timestep && next_location != goal_location)
+                return true; // it must stay at its goal from settle_timestep on
+        }
+        if (!future.empty()) {
+            auto it = future.find(Constraint(agent_id, next_location, VERTEX_CONSTRAINT, 0));
+            if (it != future.end() && timestep >= it->second)
+                return true;
+            it = future.find(Constraint(agent_id, curr_location, next_location, 0));
+            if (it != future.end() && timestep >= it->second)
+                return true;
+        }
+        return false;
+    }
+
+    // last timestep at which the goal is vertex-constrained, -1 if never, INT_MAX if forever
+    inline int get_latest_goal_timestep() const { return latest_goal_timestep; }
+
+    // last timestep at which any constraint starts or stops applying; they are all static after it
+    inline int get_last_timestep() const { return last_timestep; }
+
+    // first waypoint (timestep, location) at or after timestep, nullptr if none
+    inline const pair<const int, int>* get_next_waypoint(int timestep) const {
+        if (waypoints.empty())
+            return nullptr;
+        auto it = waypoints.lower_bound(timestep);
+        return it == waypoints.end() ? nullptr : &*it;
+    }
+
+private:
+    int agent_id = -1;
+    int goal_location = -1;
+    int latest_goal_timestep = -1;
+    int settle_timestep = INT_MAX; // first timestep from which the agent must stay at its goal
+    int last_timestep = 0;
+    unordered_set<Constraint, hash_constraint> vertex;
+    unordered_set<Constraint, hash_constraint> edge;
+    unordered_map<Constraint, int, hash_constraint> future; // constraint -> first timestep it applies
+    map<int, int> waypoints; // timestep -> location required by a positive constraint
+};
+
+// Conflict table of a search that avoids nobody; see ConflictAvoidanceTable.h for the real one
+struct NoConflicts {
+    inline int num_conflicts(int, int, int) const { return 0; }
 };
 
-// This function is used by priority_queue to prioritize nodes
-struct CompareAStarNode {
-    bool operator()(const AStarNode* n1, const AStarNode* n2) {
-        if (n1->g + n1->h == n2->g + n2->h) // if both nodes have the same f value,
-            return n1->h > n2->h; // break ties by preferring smaller h value
-        else
-            return n1->g + n1->h > n2->g + n2->h; // otherwise, prefer smaller f value
+// Orders the focal list of the bounded search: fewest conflicts, then smallest f, then smallest h
+struct CompareFocalNode {
+    const AStarNodes* nodes;
+
+    explicit CompareFocalNode(const AStarNodes* nodes): nodes(nodes) {}
+
+    bool operator()(NodeIndex i1, NodeIndex i2) const {
+        int c1 = nodes->conflicts(i1), c2 = nodes->conflicts(i2);
+        if (c1 != c2)
+            return c1 > c2;
+        return nodes->keys[i1] > nodes->keys[i2]; // the same conflicts: by f, then h
     }
 };
 
-class AStarPlanner {
+// Space-time A* over (location, timestep); OpenList is one of the open lists in OpenList.h
+template <class OpenList>
+class BasicAStarPlanner {
 public:
     const MAPFInstance& ins;
 
-    AStarPlanner(const MAPFInstance& ins): ins(ins) {}
+    BasicAStarPlanner(const MAPFInstance& ins): ins(ins), open(&nodes), compare_focal(&nodes) {}
+    // copies share the instance but start with an empty pool of their own
+    BasicAStarPlanner(const BasicAStarPlanner& other): ins(other.ins), open(&nodes), compare_focal(&nodes) {}
+
+    /* Plan ignoring all other agents */
+    inline Path find_path(int agent_id) {
+        list<Constraint> no_constraints;
+        return find_path(agent_id, no_constraints);
+    }
 
     /* Avoid rewriting code using list */
     inline Path find_path(int agent_id, list<Constraint> & constraints) {
         return find_path(agent_id,constraints.begin(), constraints.end());
     }
 
-    /* Otherwise, use iterator. Allows free choice of constraints container type */
-    template <class Iterator>
-    Path find_path(int agent_id, Iterator constraints_begin, Iterator constraints_end) {
-        this->agent_id = agent_id;
-        int start_location = ins.start_locations[agent_id];
-        int goal_location = ins.goal_locations[agent_id];
-
-        // Open list
-        priority_queue<AStarNode*, vector<AStarNode*>, CompareAStarNode> open;
-
-        // Unordered map is an associative container that contains key-value pairs with unique keys.
-        // The following unordered map is used for duplicate detection, where the key is the location of the node.
-        // unordered_map<int, AStarNode*> all_nodes;
-        // TODO: For Task 1, you need to replace the above line with
-        unordered_map<pair<int, int>, AStarNode*, hash_pair> all_nodes;
-
-        timestep = 0;
-        int h = ins.get_Manhattan_distance(start_location, goal_location); // h value for the root node
-        auto root = new AStarNode(start_location, 0, h, timestep, nullptr);
-        open.push(root);
+    /* Otherwise, use iterator. Allows free choice of constraints container type.
+     * With a conflict table (see ConflictAvoidanceTable.h), ties on f are broken
+     * in favour of fewer conflicts with the paths it holds. */
+    template <class Iterator, class ConflictTable = NoConflicts>
+    Path find_path(int agent_id, Iterator constraints_begin, Iterator constraints_end,
+                   const ConflictTable* conflict_table = nullptr) {
+        int h = start_search(agent_id, constraints_begin, constraints_end); // h value for the root node
+        if (h < 0)
+            return Path();
+        push_node(ins.start_locations[agent_id], timestep, h, NO_NODE, 0);
 
-
-        Path path;
         while (!open.empty()) {
-            curr = open.top();
-            open.pop();
-
-            timestep = curr->timestep + 1;
-
-            // goal test
-            bool has_goal_constraint = any_of(constraints_begin, constraints_end,
-                [=](const Constraint & constraint) {
-                    return getTimestep(constraint) > curr->timestep
-                        && (  getFirstLocation(constraint) == goal_location
-                           || getSecondLocation(constraint) == goal_location
-                           );
-                }
-            );
+            curr = open.pop();
+            // read before generating children, which may grow the pool
+            curr_location = nodes.locations[curr];
+            int curr_timestep = nodes.timesteps[curr];
+            timestep = curr_timestep + 1;
 
-            if (curr->location == goal_location && !has_goal_constraint) {
-                path = make_path(curr);
-                break;
-            }
+            // goal test: the agent may only stop at its goal once no later constraint can evict it
+            if (curr_location == goal_location && curr_timestep > constraint_table.get_latest_goal_timestep())
+                return make_path(curr);
 
-            if (curr->timestep > ins.num_of_agents * ins.map_size()) {
-                path = Path();
-                break;
-            }
+            if (curr_timestep > horizon)
+                return Path();
 
             /* apply constraints
-             * - curr->location at timestep-1
+             * - curr_location at timestep-1
              * - next_location at timestep
              */
-            list<int> adj_locs = ins.get_adjacent_locations(curr->location);
+            AdjacentLocations adj_locs = ins.get_adjacent_locations(curr_location);
 
-            // cout << agent_id << endl;
-            prune_nodes(adj_locs, constraints_begin, constraints_end);
+            prune_nodes(adj_locs);
 
-            AStarNode * next;
             // generate child nodes
             for (auto next_location : adj_locs) {
-                auto it = all_nodes.find(make_pair(next_location, timestep));
-
+                int next_h = heuristic(next_location, timestep);
+                if (next_h == MAPFInstance::UNREACHABLE)
+                    continue; // a waypoint can no longer be reached in time
                 // the location has not been visited before and is valid at constraint
-                if (it == all_nodes.end()) {
-                    int next_g = curr->g + 1;
-                    int next_h = ins.get_Manhattan_distance(next_location, goal_location);
-
-                    next = new AStarNode(next_location, next_g, next_h, timestep, curr);
-                    open.push(next);
+                if (all_nodes.try_insert(next_location, timestep, static_cast<NodeIndex>(nodes.size()))) {
+                    int conflicts = conflict_table == nullptr ? 0 : nodes.conflicts(curr)
+                        + conflict_table->num_conflicts(curr_location, next_location, timestep);
 
-                    all_nodes[make_pair(next_location, timestep)] = next;
+                    push_node(next_location, timestep, next_h, curr, conflicts);
                 }
                 // Note that if the location has been visited before,
                 // next_g + next_h must be greater than or equal to the f value of the existing node,
                 // because we are searching on a graph with uniform-cost edges.
                 // So we don't need to update the existing node.
+                // Conflicts only break ties, so the first node keeps its count as well.
             }
         }
 
-        // release memory
-        for (auto n : all_nodes)
-            delete n.second;
+        return Path();
+    }
 
-        return path;
+    /* Focal search (the low level of ECBS): among the generated nodes whose f is within
+     * a factor w of the smallest f, expand the one with the fewest conflicts in
+     * conflict_table (any type with num_conflicts(from, to, timestep)).
+     * The path returned is at most w times longer than a shortest one, and lower_bound
+     * receives the size no path of this agent under these constraints can beat. */
+    template <class Iterator, class ConflictTable>
+    Path find_bounded_path(int agent_id, Iterator constraints_begin, Iterator constraints_end,
+                           double w, const ConflictTable& conflict_table, int& lower_bound) {
+        int h = start_search(agent_id, constraints_begin, constraints_end);
+        if (h < 0)
+            return Path();
+        focal_bound = w * (h + 1); // bounds are on path size, i.e. f + 1
+        push_bounded_node(ins.start_locations[agent_id], timestep, h, NO_NODE, 0);
+
+        while (!focal.empty()) {
+            pop_heap(focal.begin(), focal.end(), compare_focal);
+            curr = focal.back();
+            focal.pop_back();
+            curr_location = nodes.locations[curr];
+            int curr_timestep = nodes.timesteps[curr];
+            int f_min = open_f.begin()->first;
+
+            timestep = curr_timestep + 1;
+
+            if (curr_location == goal_location && curr_timestep > constraint_table.get_latest_goal_timestep()) {
+                lower_bound = f_min + 1;
+                return make_path(curr);
+            }
+
+            auto count = open_f.find(nodes.f(curr));
+            if (--count->second == 0)
+                open_f.erase(count);
+
+            // nodes are not expanded by f here, so one past the horizon does not end the search
+            if (curr_timestep <= horizon) {
+                AdjacentLocations adj_locs = ins.get_adjacent_locations(curr_location);
+
+                prune_nodes(adj_locs);
+
+                for (auto next_location : adj_locs) {
+                    int next_h = heuristic(next_location, timestep);
+                    if (next_h == MAPFInstance::UNREACHABLE)
+                        continue;
+                    // the first node generated for a state is kept; g and h only depend on the state,
+                    // so this can only cost conflicts, never the bound
+                    if (all_nodes.try_insert(next_location, timestep, static_cast<NodeIndex>(nodes.size()))) {
+                        int conflicts = nodes.conflicts(curr)
+                            + conflict_table.num_conflicts(curr_location, next_location, timestep);
+                        push_bounded_node(next_location, timestep, next_h, curr, conflicts);
+                    }
+                }
+            }
+
+            // the smallest f never decreases, so the focal list only ever grows
+            if (!open_f.empty() && w * (open_f.begin()->first + 1) > focal_bound) {
+                focal_bound = w * (open_f.begin()->first + 1);
+                while (!waiting.empty() && waiting.begin()->first + 1 <= focal_bound) {
+                    for (NodeIndex index : waiting.begin()->second) {
+                        focal.push_back(index);
+                        push_heap(focal.begin(), focal.end(), compare_focal);
+                    }
+                    waiting.erase(waiting.begin());
+                }
+            }
+        }
+
+        return Path();
     }
 
 private:
-    AStarNode * curr;
+    NodeIndex curr;
+    int curr_location;
     int agent_id;
+    int goal_location;
     int timestep;
+    int horizon; // see search_horizon
+    const vector<int>* h_table; // exact distances to the goal, looked up in O(1) per generated node
+    ConstraintTable constraint_table;
+
+    /* Setup shared by both searches: empty the search state, index the agent's constraints
+     * and set timestep to 0. Returns the h of the root node, or -1 if there is certainly no path. */
+    template <class Iterator>
+    int start_search(int agent_id, Iterator constraints_begin, Iterator constraints_end) {
+        this->agent_id = agent_id;
+        int start_location = ins.start_locations[agent_id];
+        goal_location = ins.goal_locations[agent_id];
+
+        // the node pool, open list and duplicate table keep their memory between calls
+        clear();
+
+        h_table = &ins.get_heuristic_table(goal_location);
+        if ((*h_table)[start_location] == MAPFInstance::UNREACHABLE)
+            return -1; // the goal cannot be reached from the start at all
+
+        constraint_table.build(agent_id, goal_location, constraints_begin, constraints_end);
+        if (constraint_table.get_latest_goal_timestep() == INT_MAX)
+            return -1; // the agent can never stay at its goal
+
+        horizon = search_horizon();
+        timestep = 0;
+        return heuristic(start_location, timestep);
+    }
+
+    // Node pool: reset but not freed between calls, so repeated searches reuse its memory
+    AStarNodes nodes;
+    OpenList open;
+    // Duplicate detection, keyed by (location, timestep); see StateTable.h
+    StateTable all_nodes;
+
+    // Bounded search only: unexpanded nodes are either in the focal heap
+    // or waiting, by f, until the bound reaches them
+    vector<NodeIndex> focal;
+    CompareFocalNode compare_focal;
+    map<int, int> open_f;                  // f -> number of unexpanded nodes
+    map<int, vector<NodeIndex>> waiting;   // f -> unexpanded nodes above the bound
+    double focal_bound = 0;
+
     // used to retrieve the path from the goal node
-    Path make_path(const AStarNode* goal_node) const;
+    Path make_path(NodeIndex goal_node) const {
+        Path path;
+        for (NodeIndex index = goal_node; index != NO_NODE; index = nodes.parents[index])
+            path.push_back(nodes.locations[index]);
+        std::reverse(path.begin(), path.end());
+        return path;
+    }
+
+    // empty the node pool, open list and duplicate table while keeping their capacity
+    void clear() {
+        nodes.clear();
+        open.clear();
+        focal.clear();
+        open_f.clear();
+        waiting.clear();
+        all_nodes.reset(ins.map_size());
+    }
 
-    void clear();
+    /* No timestep past this is on a shortest path: once the constraints stop changing, the goal
+     * is less than map_size() moves away if it can be reached at all. Infeasible searches
+     * fail here instead of waiting at every location until some much later bound. */
+    inline int search_horizon() const { return constraint_table.get_last_timestep() + (int)ins.map_size(); }
+
+    /* Distance to the goal, or more when the next waypoint must be visited first;
+     * UNREACHABLE if that waypoint cannot be reached in time from location */
+    inline int heuristic(int location, int timestep) const {
+        const vector<int>& h_table = *this->h_table;
+        const pair<const int, int>* waypoint = constraint_table.get_next_waypoint(timestep);
+        if (waypoint == nullptr)
+            return h_table[location];
+        int slack = waypoint->first - timestep;
+        if (ins.get_Manhattan_distance(location, waypoint->second) > slack)
+            return MAPFInstance::UNREACHABLE;
+        if (h_table[waypoint->second] == 0)
+            return h_table[location]; // the waypoint is the goal, where the agent may already wait
+        return max(h_table[location], slack + h_table[waypoint->second]);
+    }
 
-    /* Prune nodes on any container that implements forward iterator */
-    template <class Iterator>
-    void prune_nodes(list<int> & adj_locs, Iterator constraints_begin, Iterator constraints_end) {
-        /* Capture by value lambda plus remove_if simplifies filter op. */
+    inline NodeIndex push_node(int location, int timestep, int h, NodeIndex parent, int conflicts) {
+        NodeIndex index = nodes.push_back(location, timestep, h, parent, conflicts);
+        open.push(index);
+        return index;
+    }
+
+    inline void push_bounded_node(int location, int timestep, int h, NodeIndex parent, int conflicts) {
+        NodeIndex index = nodes.push_back(location, timestep, h, parent, conflicts);
+        int f = nodes.f(index);
+        open_f[f]++;
+        if (f + 1 <= focal_bound) {
+            focal.push_back(index);
+            push_heap(focal.begin(), focal.end(), compare_focal);
+        } else {
+            waiting[f].push_back(index);
+        }
+    }
+
+    /* Drop adjacent locations that the constraint table prohibits at timestep */
+    void prune_nodes(AdjacentLocations & adj_locs) const {
         adj_locs.erase(remove_if(adj_locs.begin(), adj_locs.end(),
-            [=](int next_location) {
-                return
-                any_of(constraints_begin, constraints_end,
-                    [=](const Constraint & constraint) {
-                        bool appliesToTimestep
-                            = allRemainingTimesteps(constraint)
-                            ? timestep >= -getTimestep(constraint)
-                            : timestep == getTimestep(constraint);
-                        /* If constraint applies to agent and timestep */
-                        if ( getAgentId(constraint) == agent_id && appliesToTimestep)
-                        {
-                            return isVertexConstraint(constraint)
-                                ? next_location == getFirstLocation(constraint)
-                                : curr->location == getFirstLocation(constraint)
-                                    && next_location == getSecondLocation(constraint);
-                        }
-
-                        /* No constraints apply, next. */
-                        return false;
-                    }
-                );
+            [this](int next_location) {
+                return constraint_table.is_constrained(curr_location, next_location, timestep);
             }
         ), adj_locs.end());
     }
 };
 
+#if OPEN_LIST == OPEN_LIST_BUCKET
+typedef BasicAStarPlanner<BucketOpenList> AStarPlanner;
+#else
+typedef BasicAStarPlanner<HeapOpenList> AStarPlanner;
+#endif
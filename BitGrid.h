@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Map cells as bits, 1 iff free, stored row after row with a blocked border all around:
+// every row is padded to whole 64-bit words with at least one column on each side, and
+// there is an empty row above the first and below the last. Neighbours can be read
+// without bounds checks, and a row can be processed 64 cells per word operation.
+class BitGrid {
+public:
+    void resize(int rows, int cols) {
+        words_per_row = (cols + 2 + 63) / 64;
+        words.assign((size_t)(rows + 2) * words_per_row, 0);
+    }
+
+    inline bool is_free(int row, int col) const {
+        size_t bit = index(row, col);
+        return (words[bit >> 6] >> (bit & 63)) & 1;
+    }
+    inline void set_free(int row, int col) {
+        size_t bit = index(row, col);
+        words[bit >> 6] |= (uint64_t)1 << (bit & 63);
+    }
+
+    inline int row_words() const { return words_per_row; }
+    // word w of row, for row in [-1, rows] (the border rows included); bit i of
+    // word w is column 64 * w + i - 1, so bit 0 of word 0 is the left border
+    inline uint64_t word(int row, int w) const { return words[(size_t)(row + 1) * words_per_row + w]; }
+
+private:
+    int words_per_row = 0;
+    vector<uint64_t> words;
+
+    inline size_t index(int row, int col) const { return ((size_t)(row + 1) * words_per_row << 6) + col + 1; }
+};
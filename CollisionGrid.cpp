@@ -0,0 +1,56 @@
+#include "CollisionGrid.h"
+#include <algorithm>
+
+CollisionGrid::CollisionGrid(const vector<SharedPath> & paths): paths(paths) {
+    for (int a = 0; a < (int)paths.size(); ++a) {
+        const Path & path = *paths[a];
+        for (int t = 0; t < (int)path.size(); ++t)
+            occupied.emplace(key(path[t], t), a);
+        if (!path.empty())
+            parked.emplace(path.back(), a);
+    }
+}
+
+void CollisionGrid::find_collisions(int agent, const Path & path, vector<Collision> & collisions) const {
+    int timesteps = path.size();
+    for (int a = 0; a < (int)paths.size(); ++a)
+        if (a != agent)
+            timesteps = max(timesteps, (int)paths[a]->size());
+
+    vector<bool> found(paths.size(), false); // only the first collision with each agent is kept
+    for (int t = 0; t < timesteps; ++t) {
+        int at_t = atOrBack<int>(path, t);
+
+        // vertex collisions with agents on their paths or parked at their goals
+        auto range = occupied.equal_range(key(at_t, t));
+        for (auto it = range.first; it != range.second; ++it) {
+            if (it->second != agent && !found[it->second]) {
+                found[it->second] = true;
+                collisions.emplace_back(true, agent, it->second, t, at_t, -1);
+            }
+        }
+        auto parked_range = parked.equal_range(at_t);
+        for (auto it = parked_range.first; it != parked_range.second; ++it) {
+            int other = it->second;
+            if (other != agent && !found[other] && t >= (int)paths[other]->size()) {
+                found[other] = true;
+                collisions.emplace_back(true, agent, other, t, at_t, -1);
+            }
+        }
+
+        // edge collisions: another agent moves from at_t to bf_t while this one moves from bf_t to at_t
+        if (t == 0)
+            continue;
+        int bf_t = atOrBack<int>(path, t - 1);
+        if (bf_t == at_t)
+            continue;
+        range = occupied.equal_range(key(at_t, t - 1));
+        for (auto it = range.first; it != range.second; ++it) {
+            int other = it->second;
+            if (other != agent && !found[other] && atOrBack<int>(*paths[other], t) == bf_t) {
+                found[other] = true;
+                collisions.emplace_back(false, agent, other, t, bf_t, at_t);
+            }
+        }
+    }
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include "ConflictAvoidanceTable.h"
+#include <unordered_map>
+
+using Collision = tuple<bool, int, int, int, int, int>;
+// struct Collision {
+//     bool isVertex;
+//     int firstAgent;
+//     int secondAgent;
+//     int timestep;
+//     int firstPosition;
+//     int secondPosition;
+// };
+inline bool isVertex(Collision c) { return get<0>(c); }
+inline int getFirstAgent(Collision c) { return get<1>(c); }
+inline int getSecondAgent(Collision c) { return get<2>(c); }
+inline int getTimestep(Collision c) { return get<3>(c); }
+inline int getFirstPosition(Collision c) { return get<4>(c); }
+inline int getSecondPosition(Collision c) { return get<5>(c); }
+
+// Where every agent is at every timestep, so that the conflicts of one
+// agent's path can be found without scanning every pair of agents
+class CollisionGrid {
+public:
+    explicit CollisionGrid(const vector<SharedPath>& paths);
+
+    // append the earliest collision between path (planned for agent) and each other agent
+    void find_collisions(int agent, const Path& path, vector<Collision>& collisions) const;
+
+private:
+    const vector<SharedPath>& paths;
+    unordered_multimap<uint64_t, int> occupied; // (location, timestep) -> agent, while on its path
+    unordered_multimap<int, int> parked;         // goal location -> agent, after its path has ended
+
+    static inline uint64_t key(int location, int timestep) {
+        return ((uint64_t)(uint32_t)location << 32) | (uint32_t)timestep;
+    }
+};
@@ -0,0 +1,42 @@
+#include "ConflictAvoidanceTable.h"
+#include <algorithm>
+
+void ConflictAvoidanceTable::sync(const vector<SharedPath>& paths, int skip) {
+    held.resize(paths.size());
+    for (int a = 0; a < (int)paths.size(); a++) {
+        const Path* target = a == skip ? nullptr : paths[a].get();
+        if (held[a].get() == target)
+            continue;
+        if (held[a])
+            remove_path(*held[a]);
+        if (target)
+            add_path(*target);
+        held[a] = target ? paths[a] : nullptr; // keeps the path alive, so its address stays unique
+    }
+}
+
+void ConflictAvoidanceTable::update(const Path& path, int change) {
+    if (path.empty())
+        return;
+    for (size_t t = 0; t < path.size(); t++) {
+        auto entry = cells.emplace(key(path[t], t), Cell()).first;
+        Cell& cell = entry->second;
+        if (cell.agents == 0)
+            visits[path[t]]++;
+        cell.agents += change;
+        if (t > 0 && path[t - 1] != path[t])
+            cell.arrivals[direction(path[t], path[t - 1])] += change;
+        if (cell.agents == 0) {
+            visits[path[t]]--;
+            cells.erase(entry);
+        }
+    }
+    vector<int>& since = parked[path.back()];
+    if (change > 0) {
+        since.push_back(path.size());
+    } else {
+        since.erase(find(since.begin(), since.end(), (int)path.size()));
+        if (since.empty())
+            parked.erase(path.back());
+    }
+}
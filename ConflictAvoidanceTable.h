@@ -0,0 +1,69 @@
+#pragma once
+#include "AStarPlanner.h"
+#include <memory>
+#include <unordered_map>
+
+// Paths are immutable once planned and shared between a CBS node and its descendants
+typedef shared_ptr<const Path> SharedPath;
+
+// Occupancy of the other agents' paths, used by the low-level search to prefer, among
+// equally short paths, the one that collides least. Only the (location, timestep) pairs
+// on the held paths are stored, so the table grows with the paths rather than with the
+// map times the makespan. Adding or removing a path only touches the entries along it,
+// so a table can follow the paths of consecutive CBS nodes with sync().
+class ConflictAvoidanceTable {
+public:
+    explicit ConflictAvoidanceTable(size_t map_size): visits(map_size) {}
+
+    void add_path(const Path& path) { update(path, 1); }
+    void remove_path(const Path& path) { update(path, -1); }
+
+    // hold exactly paths, except the one of agent skip (-1 to hold all of them);
+    // only the paths that differ from the ones already held are added or removed
+    void sync(const vector<SharedPath>& paths, int skip = -1);
+
+    // collisions caused by moving from `from` to `to`, arriving at timestep
+    inline int num_conflicts(int from, int to, int timestep) const {
+        int conflicts = 0;
+        if (visits[to] > 0) {
+            auto since = parked.find(to);
+            if (since != parked.end())
+                for (int t : since->second)
+                    if (timestep >= t)
+                        conflicts++;
+            auto cell = cells.find(key(to, timestep));
+            if (cell != cells.end())
+                conflicts += cell->second.agents;
+        }
+        if (from != to && visits[from] > 0) { // an agent moving from `to` to `from` at the same time
+            auto cell = cells.find(key(from, timestep));
+            if (cell != cells.end())
+                conflicts += cell->second.arrivals[direction(from, to)];
+        }
+        return conflicts;
+    }
+
+private:
+    struct Cell {
+        uint16_t agents = 0;     // agents at this location at this timestep
+        uint8_t arrivals[4] = {}; // of which arrived from each neighbour, see direction()
+    };
+
+    unordered_map<uint64_t, Cell> cells;        // (location, timestep) -> occupancy, never empty
+    unordered_map<int, vector<int>> parked;     // location -> timesteps from which agents wait there for good
+    vector<int> visits;      // location -> entries of cells there, so most lookups are skipped
+    vector<SharedPath> held; // path held for each agent, nullptr if none
+
+    static inline uint64_t key(int location, int timestep) {
+        return ((uint64_t)(uint32_t)location << 32) | (uint32_t)timestep;
+    }
+
+    // index of neighbour among the four neighbours of location; rows and columns
+    // need not be known since a move changes the location by +-1 or +-cols
+    static inline int direction(int location, int neighbour) {
+        int delta = neighbour - location;
+        return delta == 1 ? 0 : delta == -1 ? 1 : delta > 0 ? 2 : 3;
+    }
+
+    void update(const Path& path, int change);
+};
@@ -1,51 +1,200 @@
 #include "MAPFInstance.h"
-#include <fstream>
+#include "MappedFile.h"
+#include "ThreadPool.h"
+#include <chrono>
 #include <iostream>
+#include <queue>
+
+constexpr int MAPFInstance::UNREACHABLE;
+
+namespace {
+// Scanner over the text of an instance file, read in place: whitespace-separated integers
+// and single-character map cells. Every read fails at the end of the input.
+class Scanner {
+public:
+    Scanner(const char* begin, const char* end): curr(begin), end(end) {}
+
+    inline bool read_int(int& value) {
+        skip_space();
+        bool negative = curr < end && *curr == '-';
+        if (negative)
+            curr++;
+        if (curr == end || !is_digit(*curr))
+            return false;
+        value = 0;
+        while (curr < end && is_digit(*curr))
+            value = 10 * value + (*curr++ - '0');
+        if (negative)
+            value = -value;
+        return true;
+    }
+
+    inline bool read_char(char& c) {
+        skip_space();
+        if (curr == end)
+            return false;
+        c = *curr++;
+        return true;
+    }
+
+    // the next run of non-whitespace characters
+    inline bool read_word(string& word) {
+        skip_space();
+        const char* first = curr;
+        while (curr < end && (unsigned char)*curr > ' ')
+            curr++;
+        word.assign(first, curr);
+        return curr > first;
+    }
+
+    inline void skip_line() {
+        while (curr < end && *curr != '\n')
+            curr++;
+    }
+
+private:
+    const char* curr;
+    const char* end;
+
+    static inline bool is_digit(char c) { return c >= '0' && c <= '9'; }
+    // spaces, tabs and line ends alike: none of them carries meaning in the format
+    inline void skip_space() {
+        while (curr < end && (unsigned char)*curr <= ' ')
+            curr++;
+    }
+};
+}
 
 bool MAPFInstance::load_instance(const string& fname) {
-    ifstream myfile (fname.c_str(), ios_base::in);
-    if (myfile.is_open()) {
-        myfile >> rows >> cols; // read the size of the map
-        my_map.resize(rows * cols);
-
-        // read map
-        char c;
-        for (int i = 0; i < rows; i++) {
-            for (int j = 0; j < cols; j++) {
-                myfile >> c;
-                my_map[cols * i + j] = (c != '.'); // the cell is unblocked iff it is '.'
-            }
+    auto start = chrono::steady_clock::now();
+    MappedFile file(fname);
+    if (!file.is_open())
+        return false;
+    Scanner in(file.begin(), file.end());
+    if (!in.read_int(rows) || !in.read_int(cols) || rows <= 0 || cols <= 0) // read the size of the map
+        return false;
+    my_map.resize(rows, cols);
+
+    // read map
+    char c;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            if (!in.read_char(c))
+                return false;
+            if (c == '.') // the cell is unblocked iff it is '.'
+                my_map.set_free(i, j);
         }
+    }
+
+    if (!in.read_int(num_of_agents) || num_of_agents < 0) // read the number of agents
+        return false;
+    start_locations.resize(num_of_agents);
+    goal_locations.resize(num_of_agents);
 
-        myfile >> num_of_agents; // read the number of agents
-        start_locations.resize(num_of_agents);
-        goal_locations.resize(num_of_agents);
+    // read the start and goal locations
+    int start_x, start_y, goal_x, goal_y;
+    for (int i = 0; i < num_of_agents; i++) {
+        if (!in.read_int(start_x) || !in.read_int(start_y) || !in.read_int(goal_x) || !in.read_int(goal_y))
+            return false;
+        if (!is_free_cell(start_x, start_y) || !is_free_cell(goal_x, goal_y))
+            return false; // off the map or on an obstacle
+        start_locations[i] = linearize_coordinate(start_x, start_y);
+        goal_locations[i] = linearize_coordinate(goal_x, goal_y);
+    }
+
+    init_map();
+    index_goals();
+    chrono::duration<double> load_time = chrono::steady_clock::now() - start;
+    cout << "Loaded " << fname << " in " << load_time.count() << " s (" << heuristic_tables.size()
+         << " goals, their heuristic tables are built on first use)" << endl;
+    return true;
+}
 
-        // read the start and goal locations
-        int start_x, start_y, goal_x, goal_y;
-        for (int i = 0; i < num_of_agents; i++) {
-            myfile >> start_x >> start_y >> goal_x >> goal_y;
-            start_locations[i] = linearize_coordinate(start_x, start_y);
-            goal_locations[i] = linearize_coordinate(goal_x, goal_y);
+bool MAPFInstance::load_map(const string& fname) {
+    auto start = chrono::steady_clock::now();
+    MappedFile file(fname);
+    if (!file.is_open())
+        return false;
+    Scanner in(file.begin(), file.end());
+
+    // header lines "type octile", "height H", "width W", then "map"
+    string key;
+    rows = cols = 0;
+    while (in.read_word(key) && key != "map") {
+        if (key == "height" && !in.read_int(rows))
+            return false;
+        else if (key == "width" && !in.read_int(cols))
+            return false;
+        else if (key != "height" && key != "width")
+            in.skip_line();
+    }
+    if (key != "map" || rows <= 0 || cols <= 0)
+        return false;
+    my_map.resize(rows, cols);
+
+    char c;
+    for (int i = 0; i < rows; i++) {
+        for (int j = 0; j < cols; j++) {
+            if (!in.read_char(c))
+                return false;
+            if (c == '.' || c == 'G' || c == 'S') // ground and swamp are passable; trees, water and out of bounds are not
+                my_map.set_free(i, j);
         }
-        myfile.close();
-
-        // initialize moves_offset array
-        moves_offset[valid_moves_t::WAIT_MOVE] = 0;
-        moves_offset[valid_moves_t::NORTH] = -cols;
-        moves_offset[valid_moves_t::EAST] = 1;
-        moves_offset[valid_moves_t::SOUTH] = cols;
-        moves_offset[valid_moves_t::WEST] = -1;
-        return true;
-    } else
+    }
+    num_of_agents = 0;
+    start_locations.clear();
+    goal_locations.clear();
+
+    init_map();
+    chrono::duration<double> load_time = chrono::steady_clock::now() - start;
+    cout << "Loaded " << fname << " in " << load_time.count() << " s (" << rows << "x" << cols << " map)" << endl;
+    return true;
+}
+
+bool MAPFInstance::load_scenario(const string& fname, int max_agents) {
+    auto start = chrono::steady_clock::now();
+    MappedFile file(fname);
+    if (!file.is_open())
         return false;
+    Scanner in(file.begin(), file.end());
+
+    string word;
+    if (!in.read_word(word) || word != "version")
+        return false;
+    in.skip_line();
+
+    // one agent per line: bucket, map name, map width and height, start x and y,
+    // goal x and y, optimal length; x is the column and y the row
+    start_locations.clear();
+    goal_locations.clear();
+    int bucket, width, height, start_x, start_y, goal_x, goal_y;
+    while ((int)start_locations.size() < max_agents && in.read_int(bucket)) {
+        if (!in.read_word(word) || !in.read_int(width) || !in.read_int(height)
+            || !in.read_int(start_x) || !in.read_int(start_y) || !in.read_int(goal_x) || !in.read_int(goal_y))
+            return false;
+        in.skip_line();
+        if (width != cols || height != rows)
+            return false; // the scenario belongs to another map
+        if (!is_free_cell(start_y, start_x) || !is_free_cell(goal_y, goal_x))
+            return false; // off the map or on an obstacle
+        start_locations.push_back(linearize_coordinate(start_y, start_x));
+        goal_locations.push_back(linearize_coordinate(goal_y, goal_x));
+    }
+    num_of_agents = start_locations.size();
+
+    size_t known_goals = heuristic_tables.size();
+    index_goals();
+    chrono::duration<double> load_time = chrono::steady_clock::now() - start;
+    cout << "Loaded " << num_of_agents << " agents from " << fname << " in " << load_time.count()
+         << " s (" << heuristic_tables.size() - known_goals << " new goals)" << endl;
+    return true;
 }
 
 void MAPFInstance::print_instance() const {
     cout << "Map:" << endl;
     for (int i = 0; i < rows; i++) {
         for (int j = 0; j < cols; j++) {
-            if (my_map[cols * i + j])
+            if (!my_map.is_free(i, j))
                 cout << "@"; // obstacle
             else
                 cout << "."; // free cell
@@ -66,14 +215,86 @@ int MAPFInstance::get_Manhattan_distance(int from, int to) const {
     return abs(from_x - to_x) + abs(from_y - to_y);
 }
 
-list<int> MAPFInstance::get_adjacent_locations(int location) const {
-	list<int> locations;
-	for (int direction : moves_offset) {
-		int next_location = location + direction;
-		if (0 <= next_location && next_location < cols * rows && // next_location is on the map
-		    !my_map[next_location] && // next_location is not blocked
-		    get_Manhattan_distance(location, next_location) <= 1) // it indeed moves to a neighbor location
-            locations.push_back(next_location);
-	}
-	return locations;
-}
\ No newline at end of file
+void MAPFInstance::init_map() {
+    // initialize moves_offset array
+    moves_offset[valid_moves_t::WAIT_MOVE] = 0;
+    moves_offset[valid_moves_t::NORTH] = -cols;
+    moves_offset[valid_moves_t::EAST] = 1;
+    moves_offset[valid_moves_t::SOUTH] = cols;
+    moves_offset[valid_moves_t::WEST] = -1;
+
+    compute_moves();
+    heuristic_tables.clear(); // they were computed on the previous map
+    heuristic_index.clear();
+}
+
+void MAPFInstance::compute_moves() {
+    move_masks.assign(map_size(), 0);
+    int words = my_map.row_words();
+    for (int row = 0; row < rows; row++) {
+        for (int w = 0; w < words; w++) {
+            uint64_t here = my_map.word(row, w);
+            if (here == 0)
+                continue;
+            // bit i of each word tells whether the neighbour of the cell at bit i is free;
+            // the border keeps every move from leaving the map or wrapping around a row
+            uint64_t north = my_map.word(row - 1, w);
+            uint64_t south = my_map.word(row + 1, w);
+            uint64_t east = (here >> 1) | (w + 1 < words ? my_map.word(row, w + 1) << 63 : 0);
+            uint64_t west = (here << 1) | (w > 0 ? my_map.word(row, w - 1) >> 63 : 0);
+            for (uint64_t cells = here; cells != 0; cells &= cells - 1) {
+                int i = __builtin_ctzll(cells);
+                uint8_t mask = 1 << WAIT_MOVE;
+                mask |= ((north >> i) & 1) << NORTH;
+                mask |= ((east >> i) & 1) << EAST;
+                mask |= ((south >> i) & 1) << SOUTH;
+                mask |= ((west >> i) & 1) << WEST;
+                move_masks[linearize_coordinate(row, 64 * w + i - 1)] = mask;
+            }
+        }
+    }
+}
+
+void MAPFInstance::index_goals() {
+    for (int goal : goal_locations) {
+        if (heuristic_index.count(goal))
+            continue; // another agent shares this goal, or an earlier scenario on the same map had it
+        heuristic_index[goal] = heuristic_tables.size();
+        heuristic_tables.emplace_back(new HeuristicTable());
+    }
+}
+
+void MAPFInstance::build_heuristic(int goal_location, HeuristicTable & table) const {
+    auto start = chrono::steady_clock::now();
+    // backward BFS from the goal; moves are symmetric so this gives distance-to-goal
+    table.distances = compute_distances(goal_location);
+    heuristic_nanoseconds += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+    heuristic_builds++;
+}
+
+void MAPFInstance::build_heuristics(ThreadPool * pool) const {
+    run_tasks(pool, num_of_agents, [this](int i, int) { get_heuristic_table(goal_locations[i]); });
+}
+
+vector<int> MAPFInstance::compute_distances(int source, const vector<int>& avoid) const {
+    vector<int> dist(map_size(), UNREACHABLE);
+    for (int location : avoid)
+        dist[location] = -1; // never expanded
+    queue<int> frontier;
+    dist[source] = 0;
+    frontier.push(source);
+    while (!frontier.empty()) {
+        int location = frontier.front();
+        frontier.pop();
+        for (int next_location : get_adjacent_locations(location)) {
+            if (dist[next_location] == UNREACHABLE) {
+                dist[next_location] = dist[location] + 1;
+                frontier.push(next_location);
+            }
+        }
+    }
+    for (int location : avoid)
+        if (location != source)
+            dist[location] = UNREACHABLE;
+    return dist;
+}
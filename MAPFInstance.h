@@ -2,34 +2,111 @@
 #include <vector>
 #include <list>
 #include <string>
+#include <unordered_map>
+#include <climits>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include "BitGrid.h"
 
 using namespace std;
 
+class ThreadPool;
+
+// Fixed-capacity list of adjacent locations (four moves plus wait),
+// filled in place so that node expansion never touches the heap.
+struct AdjacentLocations {
+    static constexpr int CAPACITY = 5;
+    int locations[CAPACITY];
+    int size = 0;
+
+    inline void push_back(int location) { locations[size++] = location; }
+    inline int* begin() { return locations; }
+    inline int* end() { return locations + size; }
+    inline const int* begin() const { return locations; }
+    inline const int* end() const { return locations + size; }
+    inline void erase(int* first, int* last) { // drop [first, last), as with the standard containers
+        size = static_cast<int>(copy(last, end(), first) - locations);
+    }
+};
+
 class MAPFInstance {
 public:
     vector<int> start_locations;
     vector<int> goal_locations;
     int num_of_agents;
 
-    // return true if the location is blocked by an obstacle.
-    inline bool blocked(int location) const {return my_map[location]; }
+    // return true if the location is blocked by an obstacle (free cells can at least wait).
+    inline bool blocked(int location) const { return move_masks[location] == 0; }
     inline size_t map_size() const { return rows * cols; }
 
     // This can be used as admissible heuristics
     int get_Manhattan_distance(int from, int to) const;
 
-    list<int> get_adjacent_locations(int location) const; // return unblocked adjacent locations
+    // Exact obstacle-aware distance to an agent's goal, by backward BFS. Each table is built
+    // on first use, once even when several threads ask for it at the same time, so goals
+    // a solver never looks at cost nothing. Unreachable locations hold UNREACHABLE.
+    static constexpr int UNREACHABLE = INT_MAX;
+    inline const vector<int>& get_heuristic_table(int goal_location) const {
+        HeuristicTable& table = *heuristic_tables[heuristic_index.at(goal_location)];
+        call_once(table.built, [&]() { build_heuristic(goal_location, table); });
+        return table.distances;
+    }
+    inline int get_true_distance(int from, int to) const { return get_heuristic_table(to)[from]; }
+    // build the tables of every agent's goal now, in parallel on pool (sequentially if nullptr),
+    // for solvers that need them all anyway
+    void build_heuristics(ThreadPool* pool) const;
+    // tables built so far, and the time their BFS took summed over threads
+    inline int heuristics_built() const { return heuristic_builds; }
+    inline double heuristic_seconds() const { return heuristic_nanoseconds * 1e-9; }
+    // BFS distances from source to every location, treating the avoided locations as blocked
+    vector<int> compute_distances(int source, const vector<int>& avoid = vector<int>()) const;
+
+    inline int linearize_coordinate(int row, int col) const { return (this->cols * row + col); }
+    inline int row_coordinate(int location) const { return location / this->cols; }
+    inline int col_coordinate(int location) const { return location % this->cols; }
+
+    // return unblocked adjacent locations, wait included, in the order of valid_moves_t
+    inline AdjacentLocations get_adjacent_locations(int location) const {
+        AdjacentLocations locations;
+        for (unsigned moves = move_masks[location]; moves != 0; moves &= moves - 1)
+            locations.push_back(location + moves_offset[__builtin_ctz(moves)]);
+        return locations;
+    }
     bool load_instance(const string& fname); // load instance from file
+    // MovingAI benchmark files: a .map without agents, then the first max_agents agents
+    // of a .scen on that map. Loading another scenario on the same map keeps the
+    // heuristic tables already computed, so only new goals cost a BFS.
+    bool load_map(const string& fname);
+    bool load_scenario(const string& fname, int max_agents = INT_MAX);
     void print_instance() const;
 
 private:
-  vector<bool> my_map; // my_map[i] = true iff location i is blocked
+  BitGrid my_map; // free cells
+  vector<uint8_t> move_masks; // per location, bit m set iff move m of valid_moves_t stays on a free cell
   int rows;
   int cols;
   enum valid_moves_t { NORTH, EAST, SOUTH, WEST, WAIT_MOVE, MOVE_COUNT };  // MOVE_COUNT is the enum's size
-  int moves_offset[5];
+  int moves_offset[AdjacentLocations::CAPACITY];
+
+  // one distance table per distinct goal location, shared by agents with the same goal
+  struct HeuristicTable {
+      once_flag built;
+      vector<int> distances;
+  };
+  vector<unique_ptr<HeuristicTable>> heuristic_tables;
+  unordered_map<int, size_t> heuristic_index; // goal location -> index into heuristic_tables
+  mutable atomic<int> heuristic_builds{0};
+  mutable atomic<long long> heuristic_nanoseconds{0};
 
-  inline int linearize_coordinate(int row, int col) const { return (this->cols * row + col); }
-  inline int row_coordinate(int location) const { return location / this->cols; }
-  inline int col_coordinate(int location) const { return location % this->cols; }
+  // true iff (row, col) is on the map and not an obstacle
+  inline bool is_free_cell(int row, int col) const {
+      return row >= 0 && row < rows && col >= 0 && col < cols && my_map.is_free(row, col);
+  }
+  void init_map(); // after the grid is read: moves, and no heuristic tables yet
+  void compute_moves();
+  void index_goals(); // an empty table for every goal without one
+  void build_heuristic(int goal_location, HeuristicTable& table) const;
 };
@@ -0,0 +1,24 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+using namespace std;
+
+// A whole file mapped read-only into memory, so that it can be parsed in place
+// without copying it through a stream buffer. Unmapped on destruction.
+class MappedFile {
+public:
+    explicit MappedFile(const string& fname);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // false if the file could not be opened or mapped; empty files cannot be mapped
+    inline bool is_open() const { return data != nullptr; }
+    inline const char* begin() const { return data; }
+    inline const char* end() const { return data + length; }
+
+private:
+    const char* data = nullptr;
+    size_t length = 0;
+};
@@ -0,0 +1,161 @@
+#pragma once
+#include "StateTable.h"
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+// Open lists for the low-level search, holding indices into the planner's node pool.
+// The planner takes one as a template parameter; AStarPlanner uses the one chosen at
+// compile time, e.g. -DOPEN_LIST=OPEN_LIST_BUCKET.
+#define OPEN_LIST_HEAP   0 // binary heap ordered by CompareAStarNode
+#define OPEN_LIST_BUCKET 1 // two-level bucket queue indexed by f, then h
+
+#ifndef OPEN_LIST
+#define OPEN_LIST OPEN_LIST_HEAP
+#endif
+
+// Node pool of the low-level search, stored structure-of-arrays so that each pass touches
+// only what it needs: the open list reads the packed keys alone, and a path is rebuilt
+// through the locations and parents alone. g is not stored: on the unit-cost space-time
+// graph every move or wait costs one, so g always equals the timestep. 20 bytes per node.
+class AStarNodes {
+public:
+    vector<int> locations;
+    vector<int> timesteps;     // also g
+    vector<NodeIndex> parents; // NO_NODE at the root
+    // f in the high 32 bits, then the conflicts with other agents' paths, then h, so that
+    // comparing keys orders nodes by f, then fewer conflicts, then smaller h
+    vector<uint64_t> keys;
+
+    static constexpr int MAX_CONFLICTS = (1 << 12) - 1; // counts saturate: they only break ties
+    static constexpr int MAX_H = (1 << 20) - 1;         // likewise the h stored in the key
+
+    inline size_t size() const { return locations.size(); }
+
+    inline void clear() {
+        locations.clear();
+        timesteps.clear();
+        parents.clear();
+        keys.clear();
+    }
+
+    inline NodeIndex push_back(int location, int timestep, int h, NodeIndex parent, int conflicts) {
+        NodeIndex index = static_cast<NodeIndex>(locations.size());
+        locations.push_back(location);
+        timesteps.push_back(timestep);
+        parents.push_back(parent);
+        keys.push_back(((uint64_t)(uint32_t)(timestep + h) << 32)
+                       | ((uint64_t)min(conflicts, MAX_CONFLICTS) << 20) | (uint64_t)min(h, MAX_H));
+        return index;
+    }
+
+    inline int f(NodeIndex index) const { return (int)(keys[index] >> 32); }
+    inline int h(NodeIndex index) const { return (int)(keys[index] & MAX_H); }
+    inline int conflicts(NodeIndex index) const { return (int)((keys[index] >> 20) & MAX_CONFLICTS); }
+};
+
+// This function is used by the open list heap to prioritize nodes in the pool:
+// smaller f, then fewer conflicts with the other agents, then smaller h
+struct CompareAStarNode {
+    const AStarNodes* nodes;
+
+    explicit CompareAStarNode(const AStarNodes* nodes): nodes(nodes) {}
+
+    inline bool operator()(NodeIndex i1, NodeIndex i2) const {
+        return nodes->keys[i1] > nodes->keys[i2];
+    }
+};
+
+class HeapOpenList {
+public:
+    explicit HeapOpenList(const AStarNodes* nodes): compare(nodes) {}
+
+    inline bool empty() const { return heap.empty(); }
+    inline void clear() { heap.clear(); }
+
+    inline void push(NodeIndex index) {
+        heap.push_back(index);
+        push_heap(heap.begin(), heap.end(), compare);
+    }
+
+    inline NodeIndex pop() {
+        pop_heap(heap.begin(), heap.end(), compare);
+        NodeIndex index = heap.back();
+        heap.pop_back();
+        return index;
+    }
+
+private:
+    vector<NodeIndex> heap;
+    CompareAStarNode compare;
+};
+
+// On a unit-cost grid f and h are small integers, so nodes can be kept in one bucket
+// per (f, h) and taken from the lowest f, then the lowest h, in O(1) amortized: the
+// cursors only skip buckets emptied since. A bucket is a stack linked through the pool
+// indices, so pushing never allocates once the arrays have grown to the search.
+// Conflict counts are not used to break ties; use the heap with a conflict table.
+class BucketOpenList {
+public:
+    explicit BucketOpenList(const AStarNodes* nodes): nodes(nodes) {}
+
+    inline bool empty() const { return size == 0; }
+
+    void clear() {
+        // buckets are emptied by pops, so only the rows still holding nodes need a reset
+        for (int f = lowest_f; size > 0 && f < (int)heads.size(); f++) {
+            if (row_size[f] == 0)
+                continue;
+            fill(heads[f].begin(), heads[f].end(), NO_NODE);
+            size -= row_size[f];
+            row_size[f] = 0;
+            lowest_h[f] = INT_MAX;
+        }
+        size = 0;
+        lowest_f = INT_MAX;
+    }
+
+    inline void push(NodeIndex index) {
+        int f = nodes->f(index), h = nodes->h(index);
+        if (f >= (int)heads.size()) {
+            heads.resize(f + 1);
+            row_size.resize(f + 1, 0);
+            lowest_h.resize(f + 1, INT_MAX);
+        }
+        vector<NodeIndex>& row = heads[f];
+        if (h >= (int)row.size())
+            row.resize(h + 1, NO_NODE);
+        if (index >= next.size())
+            next.resize(max((size_t)index + 1, 2 * next.size()));
+        next[index] = row[h];
+        row[h] = index;
+        row_size[f]++;
+        size++;
+        lowest_f = min(lowest_f, f); // f may drop below the last one popped for an inconsistent h
+        lowest_h[f] = min(lowest_h[f], h);
+    }
+
+    inline NodeIndex pop() {
+        while (row_size[lowest_f] == 0)
+            lowest_f++;
+        vector<NodeIndex>& row = heads[lowest_f];
+        int& h = lowest_h[lowest_f];
+        while (row[h] == NO_NODE)
+            h++;
+        NodeIndex index = row[h];
+        row[h] = next[index];
+        size--;
+        if (--row_size[lowest_f] == 0)
+            h = INT_MAX;
+        return index;
+    }
+
+private:
+    const AStarNodes* nodes;
+    vector<vector<NodeIndex>> heads; // heads[f][h]: last node pushed with that f and h, NO_NODE if none
+    vector<NodeIndex> next;          // next node in the same bucket, by pool index
+    vector<int> row_size;            // nodes per f
+    vector<int> lowest_h;            // lowest h that may hold nodes per f, INT_MAX if none
+    int lowest_f = INT_MAX;          // lowest f that may hold nodes
+    size_t size = 0;
+};
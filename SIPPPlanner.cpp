@@ -0,0 +1,46 @@
+#include "SIPPPlanner.h"
+#include <algorithm> // sort, unique, reverse
+
+void SIPPPlanner::make_intervals(int location, vector<int>& timesteps, int blocked_from) {
+    sort(timesteps.begin(), timesteps.end());
+    timesteps.erase(unique(timesteps.begin(), timesteps.end()), timesteps.end());
+
+    vector<SafeInterval>& safe = intervals[location];
+    int low = 0;
+    for (int t : timesteps) {
+        if (t >= blocked_from)
+            break;
+        if (low <= t - 1)
+            safe.emplace_back(low, t - 1);
+        low = t + 1;
+    }
+    int high = blocked_from == INT_MAX ? INT_MAX : blocked_from - 1;
+    if (low <= high)
+        safe.emplace_back(low, high);
+    if (safe.empty())
+        safe.emplace_back(INT_MAX, INT_MAX - 1); // never safe; rejected by every arrival check
+}
+
+Path SIPPPlanner::make_path(NodeIndex goal_node) const {
+    Path path;
+    NodeIndex curr = goal_node;
+    while (curr != NO_NODE) {
+        const SIPPNode& node = nodes[curr];
+        path.push_back(node.location);
+        if (node.parent != NO_NODE) {
+            // the agent waited at the parent's location until it could move here
+            for (int t = nodes[node.parent].g + 1; t < node.g; t++)
+                path.push_back(nodes[node.parent].location);
+        }
+        curr = node.parent;
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+void SIPPPlanner::clear() {
+    nodes.clear();
+    open.clear();
+    best_arrival.clear();
+    intervals.clear();
+}
@@ -0,0 +1,185 @@
+#pragma once
+#include "AStarPlanner.h"
+
+// Safe interval [low, high] of a location: maximal run of timesteps
+// at which no vertex constraint of the planning agent occupies it
+struct SafeInterval {
+    int low;
+    int high; // INT_MAX if the location stays safe forever
+
+    SafeInterval(int low, int high): low(low), high(high) {}
+};
+
+// A SIPP state is a location together with one of its safe intervals.
+// g is the earliest known arrival timestep within that interval.
+struct SIPPNode {
+    int location;
+    int interval;
+    int g;
+    int h;
+    NodeIndex parent;
+
+    SIPPNode(int location, int interval, int g, int h, NodeIndex parent):
+            location(location), interval(interval), g(g), h(h), parent(parent) {}
+};
+
+struct CompareSIPPNode {
+    const vector<SIPPNode>* nodes;
+
+    explicit CompareSIPPNode(const vector<SIPPNode>* nodes): nodes(nodes) {}
+
+    bool operator()(NodeIndex i1, NodeIndex i2) const {
+        const SIPPNode& n1 = (*nodes)[i1];
+        const SIPPNode& n2 = (*nodes)[i2];
+        if (n1.g + n1.h == n2.g + n2.h) // if both nodes have the same f value,
+            return n1.h > n2.h; // break ties by preferring smaller h value
+        else
+            return n1.g + n1.h > n2.g + n2.h; // otherwise, prefer smaller f value
+    }
+};
+
+// Safe Interval Path Planning: searches over (location, safe interval) states
+// instead of (location, timestep), so waiting never creates search nodes.
+// Drop-in replacement for AStarPlanner::find_path on the same constraints.
+class SIPPPlanner {
+public:
+    const MAPFInstance& ins;
+
+    SIPPPlanner(const MAPFInstance& ins): ins(ins), compare(&nodes) {}
+    // copies share the instance but start with an empty pool of their own
+    SIPPPlanner(const SIPPPlanner& other): ins(other.ins), compare(&nodes) {}
+
+    inline Path find_path(int agent_id, list<Constraint> & constraints) {
+        return find_path(agent_id, constraints.begin(), constraints.end());
+    }
+
+    template <class Iterator>
+    Path find_path(int agent_id, Iterator constraints_begin, Iterator constraints_end) {
+        int start_location = ins.start_locations[agent_id];
+        int goal_location = ins.goal_locations[agent_id];
+
+        clear();
+
+        const vector<int>& h_table = ins.get_heuristic_table(goal_location);
+        if (h_table[start_location] == MAPFInstance::UNREACHABLE)
+            return Path(); // the goal cannot be reached from the start at all
+
+        // edge constraints are checked through the constraint table,
+        // vertex constraints are folded into the safe intervals
+        constraint_table.build(agent_id, goal_location, constraints_begin, constraints_end);
+        if (constraint_table.get_latest_goal_timestep() == INT_MAX)
+            return Path(); // the agent can never stay at its goal
+        build_intervals(agent_id, constraints_begin, constraints_end);
+
+        const vector<SafeInterval>& start_intervals = get_intervals(start_location);
+        if (start_intervals.front().low > 0)
+            return Path(); // the start itself is constrained at timestep 0
+        best_arrival[state_key(start_location, 0)] = 0;
+        push_node(SIPPNode(start_location, 0, 0, h_table[start_location], NO_NODE));
+
+        while (!open.empty()) {
+            pop_heap(open.begin(), open.end(), compare);
+            NodeIndex curr = open.back();
+            open.pop_back();
+            const SIPPNode curr_node = nodes[curr]; // copied, the pool may grow below
+            if (curr_node.g > best_arrival[state_key(curr_node.location, curr_node.interval)])
+                continue; // a better copy of this state was generated later
+
+            const SafeInterval curr_interval = get_intervals(curr_node.location)[curr_node.interval];
+
+            // goal test: only the last interval of the goal lets the agent stay there for good
+            if (curr_node.location == goal_location && curr_interval.high == INT_MAX)
+                return make_path(curr);
+
+            AdjacentLocations adj_locs = ins.get_adjacent_locations(curr_node.location);
+            for (int next_location : adj_locs) {
+                if (next_location == curr_node.location || h_table[next_location] == MAPFInstance::UNREACHABLE)
+                    continue; // waiting is implicit in the arrival time
+
+                const vector<SafeInterval>& next_intervals = get_intervals(next_location);
+                for (int i = 0; i < (int)next_intervals.size(); i++) {
+                    const SafeInterval& next_interval = next_intervals[i];
+                    // leave no later than the end of the current interval
+                    int latest = curr_interval.high == INT_MAX ? next_interval.high
+                                                               : min(curr_interval.high + 1, next_interval.high);
+                    int arrival = max(curr_node.g + 1, next_interval.low);
+                    while (arrival <= latest
+                           && constraint_table.is_constrained(curr_node.location, next_location, arrival))
+                        arrival++; // wait out edge constraints
+                    if (arrival > latest)
+                        continue;
+
+                    uint64_t key = state_key(next_location, i);
+                    auto it = best_arrival.find(key);
+                    if (it != best_arrival.end() && it->second <= arrival)
+                        continue;
+                    best_arrival[key] = arrival;
+                    push_node(SIPPNode(next_location, i, arrival, h_table[next_location], curr));
+                }
+            }
+        }
+
+        return Path();
+    }
+
+private:
+    ConstraintTable constraint_table;
+
+    // safe intervals of the locations that have vertex constraints, sorted by time;
+    // every other location has the single interval [0, INT_MAX]
+    unordered_map<int, vector<SafeInterval>> intervals;
+    const vector<SafeInterval> always_safe = { SafeInterval(0, INT_MAX) };
+
+    vector<SIPPNode> nodes; // node pool, reset but not freed between calls
+    vector<NodeIndex> open; // binary heap of pool indices
+    CompareSIPPNode compare;
+    unordered_map<uint64_t, int> best_arrival; // (location, interval) -> earliest arrival generated
+
+    static inline uint64_t state_key(int location, int interval) {
+        return ((uint64_t)(uint32_t)location << 32) | (uint32_t)interval;
+    }
+
+    inline const vector<SafeInterval>& get_intervals(int location) const {
+        if (intervals.empty())
+            return always_safe;
+        auto it = intervals.find(location);
+        return it == intervals.end() ? always_safe : it->second;
+    }
+
+    template <class Iterator>
+    void build_intervals(int agent_id, Iterator constraints_begin, Iterator constraints_end) {
+        unordered_map<int, vector<int>> blocked; // location -> constrained timesteps
+        unordered_map<int, int> blocked_from;    // location -> first timestep of a permanent block
+        for (auto it = constraints_begin; it != constraints_end; ++it) {
+            const Constraint& constraint = *it;
+            if (getAgentId(constraint) != agent_id || !isVertexConstraint(constraint))
+                continue;
+            int location = getFirstLocation(constraint);
+            if (allRemainingTimesteps(constraint)) {
+                auto found = blocked_from.find(location);
+                if (found == blocked_from.end() || found->second > -getTimestep(constraint))
+                    blocked_from[location] = -getTimestep(constraint);
+                blocked[location]; // make sure the location gets intervals
+            } else {
+                blocked[location].push_back(getTimestep(constraint));
+            }
+        }
+        for (auto& entry : blocked) {
+            auto found = blocked_from.find(entry.first);
+            make_intervals(entry.first, entry.second, found == blocked_from.end() ? INT_MAX : found->second);
+        }
+    }
+
+    // turn the constrained timesteps of a location into its safe intervals
+    void make_intervals(int location, vector<int>& timesteps, int blocked_from);
+
+    Path make_path(NodeIndex goal_node) const;
+
+    void clear();
+
+    inline void push_node(const SIPPNode& node) {
+        nodes.push_back(node);
+        open.push_back(static_cast<NodeIndex>(nodes.size() - 1));
+        push_heap(open.begin(), open.end(), compare);
+    }
+};
@@ -0,0 +1,182 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+
+using namespace std;
+
+// Duplicate detection tables for the low-level search, mapping a
+// (location, timestep) state to the index of its node in the planner's pool.
+// The implementation is chosen at compile time, e.g. -DSTATE_TABLE=STATE_TABLE_DENSE.
+#define STATE_TABLE_UNORDERED 0 // unordered_map with hash_pair, kept for comparison
+#define STATE_TABLE_HASH      1 // open addressing with a 64-bit key mix
+#define STATE_TABLE_DENSE     2 // map_size x horizon array, grown one timestep layer at a time
+
+#ifndef STATE_TABLE
+#define STATE_TABLE STATE_TABLE_HASH
+#endif
+
+// Nodes live contiguously in the planner's node pool and refer to each other by index
+typedef uint32_t NodeIndex;
+constexpr NodeIndex NO_NODE = UINT32_MAX;
+
+// Total slots inspected by all state table lookups; only counted with -DSTATE_TABLE_STATS
+inline uint64_t& state_table_probes() {
+    static uint64_t probes = 0;
+    return probes;
+}
+
+#ifdef STATE_TABLE_STATS
+#define COUNT_STATE_TABLE_PROBE() (++state_table_probes())
+#else
+#define COUNT_STATE_TABLE_PROBE() ((void)0)
+#endif
+
+// A hash function used to hash a pair of any kind
+// This will be used in Task 1 when you try to
+// use pair as the key of an unordered_map
+struct hash_pair {
+    template <class T1, class T2>
+    size_t operator()(const pair<T1, T2>& p) const
+    {
+        auto hash1 = hash<T1>{}(p.first);
+        auto hash2 = hash<T2>{}(p.second);
+        return hash1 ^ hash2;
+    }
+};
+
+class UnorderedStateTable {
+public:
+    void reset(size_t) { table.clear(); }
+
+    // insert the state unless it is already present; returns true iff inserted
+    bool try_insert(int location, int timestep, NodeIndex node) {
+        auto key = make_pair(location, timestep);
+#ifdef STATE_TABLE_STATS
+        size_t bucket = table.bucket_count() ? table.bucket(key) : 0;
+        for (auto it = table.begin(bucket); table.bucket_count() && it != table.end(bucket); ++it) {
+            COUNT_STATE_TABLE_PROBE();
+            if (it->first == key)
+                break;
+        }
+#endif
+        return table.emplace(key, node).second;
+    }
+
+private:
+    unordered_map<pair<int, int>, NodeIndex, hash_pair> table;
+};
+
+class HashStateTable {
+public:
+    void reset(size_t) {
+        for (size_t i : used)
+            slots[i] = Slot();
+        used.clear();
+        size = 0;
+    }
+
+    // insert the state unless it is already present; returns true iff inserted
+    bool try_insert(int location, int timestep, NodeIndex node) {
+        if (2 * (size + 1) > slots.size())
+            grow();
+        uint64_t key = make_key(location, timestep);
+        size_t i = probe(key);
+        if (slots[i].key == key)
+            return false;
+        slots[i] = Slot(key, node);
+        used.push_back(i);
+        ++size;
+        return true;
+    }
+
+private:
+    struct Slot {
+        uint64_t key;
+        NodeIndex node;
+        Slot(): key(EMPTY), node(NO_NODE) {}
+        Slot(uint64_t key, NodeIndex node): key(key), node(node) {}
+    };
+    static constexpr uint64_t EMPTY = UINT64_MAX;
+
+    vector<Slot> slots; // capacity is a power of two, kept at most half full
+    vector<size_t> used; // filled slots, so that a small search after a large one resets only its own
+    size_t size = 0;
+
+    static inline uint64_t make_key(int location, int timestep) {
+        return ((uint64_t)(uint32_t)location << 32) | (uint32_t)timestep;
+    }
+
+    // splitmix64 finalizer: every key bit affects every slot bit
+    static inline uint64_t mix(uint64_t key) {
+        key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+        return key ^ (key >> 31);
+    }
+
+    // linear probing: slot holding key, or the empty slot where it belongs
+    inline size_t probe(uint64_t key) const {
+        size_t mask = slots.size() - 1;
+        size_t i = mix(key) & mask;
+        COUNT_STATE_TABLE_PROBE();
+        while (slots[i].key != key && slots[i].key != EMPTY) {
+            i = (i + 1) & mask;
+            COUNT_STATE_TABLE_PROBE();
+        }
+        return i;
+    }
+
+    void grow() {
+        vector<Slot> old;
+        old.swap(slots);
+        slots.resize(old.empty() ? 1024 : 2 * old.size());
+        used.clear();
+        for (const Slot& slot : old) {
+            if (slot.key != EMPTY) {
+                size_t i = probe(slot.key);
+                slots[i] = slot;
+                used.push_back(i);
+            }
+        }
+    }
+};
+
+class DenseStateTable {
+public:
+    void reset(size_t map_size) {
+        for (size_t cell : touched)
+            cells[cell] = NO_NODE;
+        touched.clear();
+        if (map_size != layer_size) {
+            cells.clear();
+            layer_size = map_size;
+        }
+    }
+
+    // insert the state unless it is already present; returns true iff inserted
+    bool try_insert(int location, int timestep, NodeIndex node) {
+        size_t cell = (size_t)timestep * layer_size + location;
+        if (cell >= cells.size())
+            cells.resize(((size_t)timestep + 1) * layer_size, NO_NODE); // add the missing layers
+        COUNT_STATE_TABLE_PROBE();
+        if (cells[cell] != NO_NODE)
+            return false;
+        cells[cell] = node;
+        touched.push_back(cell);
+        return true;
+    }
+
+private:
+    size_t layer_size = 0;
+    vector<NodeIndex> cells;    // cells[timestep * layer_size + location]
+    vector<size_t> touched;     // filled cells, so reset does not sweep every layer
+};
+
+#if STATE_TABLE == STATE_TABLE_UNORDERED
+typedef UnorderedStateTable StateTable;
+#elif STATE_TABLE == STATE_TABLE_DENSE
+typedef DenseStateTable StateTable;
+#else
+typedef HashStateTable StateTable;
+#endif
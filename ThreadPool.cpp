@@ -0,0 +1,64 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(int num_threads): next_index(0) {
+    for (int i = 0; i < num_threads; i++)
+        workers.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+int ThreadPool::hardware_threads() {
+    int threads = (int)thread::hardware_concurrency();
+    return threads > 0 ? threads : 1;
+}
+
+void ThreadPool::run(int count, const function<void(int, int)>& task) {
+    if (count <= 0)
+        return;
+    unique_lock<mutex> guard(lock);
+    this->task = &task;
+    this->count = count;
+    next_index = 0;
+    active = size();
+    ++generation;
+    wake.notify_all();
+    finished.wait(guard, [this]() { return active == 0; });
+    this->task = nullptr;
+}
+
+void ThreadPool::work(int worker) {
+    int seen = 0;
+    while (true) {
+        {
+            unique_lock<mutex> guard(lock);
+            wake.wait(guard, [&]() { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        for (int i = next_index++; i < count; i = next_index++)
+            (*task)(i, worker);
+        {
+            lock_guard<mutex> guard(lock);
+            if (--active == 0)
+                finished.notify_one();
+        }
+    }
+}
+
+void run_tasks(ThreadPool* pool, int count, const function<void(int, int)>& task) {
+    if (pool) {
+        pool->run(count, task);
+    } else {
+        for (int i = 0; i < count; i++)
+            task(i, 0);
+    }
+}
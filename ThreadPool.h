@@ -0,0 +1,47 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+using namespace std;
+
+// A fixed set of worker threads that run parallel loops. The tasks of a loop are
+// handed out one index at a time from a shared counter, so a worker that finishes
+// early keeps taking the remaining tasks instead of idling.
+// Every task also receives the index of its worker, so callers can keep
+// per-worker state such as a planner without any locking.
+class ThreadPool {
+public:
+    explicit ThreadPool(int num_threads);
+    ~ThreadPool();
+
+    inline int size() const { return (int)workers.size(); }
+
+    // run task(index, worker) for every index in [0, count) and wait until all have finished
+    void run(int count, const function<void(int, int)>& task);
+
+    // number of hardware threads, at least 1
+    static int hardware_threads();
+
+private:
+    vector<thread> workers;
+    mutex lock;
+    condition_variable wake;     // a new loop was started, or the pool is stopping
+    condition_variable finished; // the last active worker ran out of tasks
+
+    const function<void(int, int)>* task = nullptr;
+    int count = 0;
+    atomic<int> next_index;
+    int active = 0;
+    int generation = 0; // incremented per loop so workers do not rerun an old one
+    bool stopping = false;
+
+    void work(int worker);
+};
+
+// run task(index, worker) for every index in [0, count) on pool,
+// or sequentially as worker 0 when pool is nullptr
+void run_tasks(ThreadPool* pool, int count, const function<void(int, int)>& task);
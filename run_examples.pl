@@ -34,6 +34,7 @@ my $debug     = '';
 my $verbose   = '';
 my $yes       = '';
 my $visualize = '';
+my $probes    = '';
 my $start     = 1;
 my $end       = 50;
 my $prefix;
@@ -47,6 +48,7 @@ GetOptions(
     'verbose|v'      => \$verbose,
     'yes'            => \$yes,
     'visualize|see'  => \$visualize,
+    'probes'         => \$probes,
     'test=s'         => \$test,
     'start=i'        => \$start,
     'prefix=s'       => \$prefix,
@@ -120,6 +122,7 @@ if ( defined $experiment ) {
 my @cpu_times;
 my @costs;
 my @num_paths;
+my @probe_counts;
 
 foreach (@experiments) {
     print "Experiment $_\n" if $verbose;
@@ -150,10 +153,21 @@ foreach (@experiments) {
     push @cpu_times, $cpu_time;
     push @costs,     $sum_of_cost;
     push @num_paths, $this_num_paths if $test;
+
+    if ($probes) {
+        my ($probe_count) = $out =~ m/State table probes: ([0-9]+)/mg;
+        push @probe_counts, $probe_count // 0;
+    }
 }
 
 print "Times:\n" . ( join ",", @cpu_times ) . "\n";
 print "Costs:\n" . ( join ",", @costs ) . "\n";
+if ($probes) {
+    my $total_probes = 0;
+    $total_probes += $_ foreach @probe_counts;
+    print "Probes:\n" . ( join ",", @probe_counts ) . "\n";
+    print "Total probes: $total_probes\n";
+}
 
 run_tests if $test;
 
@@ -242,6 +256,9 @@ run_examples.pl [options] [executable]
         - experiment x  The number of the experiment to run (1-50).
         - timeout s     Terminate execution after time. Ex: -t 5s
         - test cbs|pp   Run on testing cases instead. Compare to given path lengths.
+        - probes        Collect state table probe counts. Requires a build with
+                        -DSTATE_TABLE_STATS, e.g.
+                        cmake -DCMAKE_CXX_FLAGS="-DSTATE_TABLE_STATS -DSTATE_TABLE=STATE_TABLE_UNORDERED" .
 
 =head1 AUTHOR
 Jeremy Nuttall
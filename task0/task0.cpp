@@ -2,11 +2,23 @@
 #include <fstream>
 #include "MAPFInstance.h"
 #include "AStarPlanner.h"
+#include "ThreadPool.h"
+#include <memory>
 
 int main(int argc, char *argv[]) {
     MAPFInstance ins;
     string input_file = argv[1];
     string output_file = argv[2];
+    int threads = 1;
+    for (int i = 3; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--threads" && i + 1 < argc)
+            threads = atoi(argv[++i]); // 0 uses every hardware thread
+        else
+            cout << "Ignoring unknown option " << option << endl;
+    }
+    if (threads <= 0)
+        threads = ThreadPool::hardware_threads();
     if (ins.load_instance(input_file)) {
         ins.print_instance();
     } else {
@@ -14,11 +26,13 @@ int main(int argc, char *argv[]) {
         exit(-1);
     }
 
-    AStarPlanner a_star(ins);
+    // one planner per worker; paths[i] is written only by the task planning agent i
+    vector<AStarPlanner> planners(threads, AStarPlanner(ins));
+    unique_ptr<ThreadPool> pool(threads > 1 ? new ThreadPool(threads) : nullptr);
     vector<Path> paths(ins.num_of_agents);
-    for (int i = 0; i < ins.num_of_agents; i++) {
-        paths[i] = a_star.find_path(i); // plan paths independently by ignoring other agents
-    }
+    run_tasks(pool.get(), ins.num_of_agents, [&](int i, int worker) {
+        paths[i] = planners[worker].find_path(i); // plan paths independently by ignoring other agents
+    });
 
     // print paths
     cout << "Paths:" << endl;
@@ -28,6 +42,7 @@ int main(int argc, char *argv[]) {
         sum += paths[i].size();
     }
     cout << "Sum of cost: " << sum << endl;
+    cout << "Heuristic tables: " << ins.heuristics_built() << " built in " << ins.heuristic_seconds() << " s" << endl;
 
     // save paths
     ofstream myfile (output_file.c_str(), ios_base::out);
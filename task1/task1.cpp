@@ -2,12 +2,24 @@
 #include <fstream>
 #include "MAPFInstance.h"
 #include "AStarPlanner.h"
+#include "ThreadPool.h"
+#include <memory>
 #include <tuple>
 
 int main(int argc, char *argv[]) {
     MAPFInstance ins;
     string input_file = argv[1];
     string output_file = argv[2];
+    int threads = 1;
+    for (int i = 3; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--threads" && i + 1 < argc)
+            threads = atoi(argv[++i]); // 0 uses every hardware thread
+        else
+            cout << "Ignoring unknown option " << option << endl;
+    }
+    if (threads <= 0)
+        threads = ThreadPool::hardware_threads();
     if (ins.load_instance(input_file)) {
         ins.print_instance();
     } else {
@@ -15,27 +27,32 @@ int main(int argc, char *argv[]) {
         exit(-1);
     }
 
-    AStarPlanner a_star(ins);
+    // the same constraints apply to every agent, so they are only read while planning
+    list<Constraint> constraints;
+    // TODO: Define constraints
+    //  constraints for Q1
+    // constraints.push_back(Constraint(0, ins.goal_locations[0], VERTEX_CONSTRAINT, 4));
+    // for (int loc : ins.get_adjacent_locations(ins.start_locations[1])) {
+    //     if (loc != ins.start_locations[1]) {
+    //         constraints.push_back(Constraint(1, ins.start_locations[1], loc, 1));
+    //     }
+    // }
+    //  constraints for Q2
+    // constraints.push_back(Constraint(0, ins.goal_locations[0], VERTEX_CONSTRAINT, 10));
+    //  constraints for Q3
+    constraints.push_back(Constraint(1, 10, 11, 2));
+    constraints.push_back(Constraint(1, 10, VERTEX_CONSTRAINT, 2));
+    constraints.push_back(Constraint(1, 10, 9, 2));
+
+    // one planner per worker; paths[i] is written only by the task planning agent i
+    vector<AStarPlanner> planners(threads, AStarPlanner(ins));
+    unique_ptr<ThreadPool> pool(threads > 1 ? new ThreadPool(threads) : nullptr);
     vector<Path> paths(ins.num_of_agents);
-    for (int i = 0; i < ins.num_of_agents; i++) {
-        list<Constraint> constraints;
-        // TODO: Define constraints
-        //  constraints for Q1
-        // constraints.push_back(Constraint(0, ins.goal_locations[0], VERTEX_CONSTRAINT, 4));
-        // for (int loc : ins.get_adjacent_locations(ins.start_locations[1])) {
-        //     if (loc != ins.start_locations[1]) {
-        //         constraints.push_back(Constraint(1, ins.start_locations[1], loc, 1));
-        //     }
-        // }
-        //  constraints for Q2
-        // constraints.push_back(Constraint(0, ins.goal_locations[0], VERTEX_CONSTRAINT, 10));
-        //  constraints for Q3
-        constraints.push_back(Constraint(1, 10, 11, 2));
-        constraints.push_back(Constraint(1, 10, VERTEX_CONSTRAINT, 2));
-        constraints.push_back(Constraint(1, 10, 9, 2));
-        //  Replace the following line with something like paths[i] = a_star.find_path(i, constraints);
-        paths[i] = a_star.find_path(i, constraints);
+    run_tasks(pool.get(), ins.num_of_agents, [&](int i, int worker) {
+        paths[i] = planners[worker].find_path(i, constraints.begin(), constraints.end());
+    });
 
+    for (int i = 0; i < ins.num_of_agents; i++) {
         if (paths[i].empty()) {
             cout << "Fail to find any solutions for agent " << i << endl;
             return 0;
@@ -50,6 +67,7 @@ int main(int argc, char *argv[]) {
         sum += paths[i].size();
     }
     cout << "Sum of cost: " << sum << endl;
+    cout << "Heuristic tables: " << ins.heuristics_built() << " built in " << ins.heuristic_seconds() << " s" << endl;
 
     // save paths
     ofstream myfile (output_file.c_str(), ios_base::out);
@@ -0,0 +1,197 @@
+#include "LNS.h"
+#include <iostream>
+#include <algorithm>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+
+const char* const NEIGHBORHOOD_NAMES[NEIGHBORHOOD_TYPES] = { "random", "agent", "map" };
+constexpr double REACTION = 0.1;    // weight of the last improvement in a neighborhood's weight
+constexpr double MIN_WEIGHT = 0.01; // so that no neighborhood type is abandoned for good
+constexpr int MAX_WALKS = 10;       // random walks per agent-based neighborhood
+constexpr int REGION_PER_AGENT = 16; // locations searched per agent in a map-based neighborhood
+
+} // namespace
+
+LNS::LNS(const MAPFInstance & ins, const LNSOptions & options):
+        ins(ins), options(options), a_star(ins), sipp(ins), random(options.seed), tabu(ins.num_of_agents, false) {
+    fill(weights, weights + NEIGHBORHOOD_TYPES, 1.0);
+}
+
+void LNS::improve(vector<Path> & solution) {
+    auto start = chrono::steady_clock::now();
+    paths.clear();
+    int sum = 0;
+    for (const Path & path : solution) {
+        paths.push_back(make_shared<const Path>(path));
+        sum += path.size();
+    }
+
+    vector<int> neighborhood;
+    for (int iteration = 1; ; iteration++) {
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        if (elapsed.count() >= options.time_limit)
+            break;
+
+        discrete_distribution<int> choose(weights, weights + NEIGHBORHOOD_TYPES);
+        auto type = (NeighborhoodType)choose(random);
+        neighborhood.clear();
+        if (type == AGENT_NEIGHBORHOOD)
+            agent_neighborhood(neighborhood);
+        else if (type == MAP_NEIGHBORHOOD)
+            map_neighborhood(neighborhood);
+        if (neighborhood.empty()) { // nothing to choose from, e.g. no agent is delayed
+            type = RANDOM_NEIGHBORHOOD;
+            random_neighborhood(neighborhood);
+        }
+
+        int improvement = replan(neighborhood);
+        sum -= improvement;
+        weights[type] = max(MIN_WEIGHT, REACTION * improvement + (1 - REACTION) * weights[type]);
+
+        elapsed = chrono::steady_clock::now() - start;
+        cout << "Iteration " << iteration << ": sum of cost " << sum << ", " << elapsed.count() << " s ("
+             << NEIGHBORHOOD_NAMES[type] << " neighborhood of " << neighborhood.size() << ")" << endl;
+    }
+
+    for (int a = 0; a < ins.num_of_agents; a++)
+        solution[a] = *paths[a];
+}
+
+void LNS::random_neighborhood(vector<int> & neighborhood) {
+    vector<int> agents(ins.num_of_agents);
+    for (int a = 0; a < ins.num_of_agents; a++)
+        agents[a] = a;
+    shuffle(agents.begin(), agents.end(), random);
+    neighborhood.assign(agents.begin(), agents.begin() + min(options.neighborhood_size, ins.num_of_agents));
+}
+
+void LNS::agent_neighborhood(vector<int> & neighborhood) {
+    auto delay = [this](int a) {
+        return (int)paths[a]->size() - 1 - ins.get_true_distance(ins.start_locations[a], ins.goal_locations[a]);
+    };
+    int chosen = -1;
+    for (int round = 0; round < 2 && chosen < 0; round++) {
+        for (int a = 0; a < ins.num_of_agents; a++)
+            if (!tabu[a] && delay(a) > 0 && (chosen < 0 || delay(a) > delay(chosen)))
+                chosen = a;
+        if (chosen < 0)
+            fill(tabu.begin(), tabu.end(), false); // every delayed agent had its turn
+    }
+    if (chosen < 0)
+        return;
+    tabu[chosen] = true;
+    neighborhood.push_back(chosen);
+
+    // walk from random points of its path along moves that could still make it shorter,
+    // and take the agents met on the way
+    const Path & path = *paths[chosen];
+    const vector<int> & h_table = ins.get_heuristic_table(ins.goal_locations[chosen]);
+    CollisionGrid grid(paths);
+    vector<Collision> met;
+    vector<int> moves;
+    for (int walk = 0; walk < MAX_WALKS && (int)neighborhood.size() < options.neighborhood_size; walk++) {
+        int t = uniform_int_distribution<int>(0, path.size() - 2)(random);
+        Path steps(path.begin(), path.begin() + t + 1);
+        while (steps.size() < path.size()) {
+            moves.clear();
+            for (int next : ins.get_adjacent_locations(steps.back()))
+                if ((int)steps.size() + h_table[next] < (int)path.size() - 1)
+                    moves.push_back(next);
+            if (moves.empty())
+                break;
+            steps.push_back(moves[uniform_int_distribution<int>(0, moves.size() - 1)(random)]);
+        }
+        met.clear();
+        grid.find_collisions(chosen, steps, met);
+        for (const Collision & collision : met) {
+            int other = getSecondAgent(collision);
+            if ((int)neighborhood.size() < options.neighborhood_size
+                    && find(neighborhood.begin(), neighborhood.end(), other) == neighborhood.end())
+                neighborhood.push_back(other);
+        }
+    }
+}
+
+void LNS::map_neighborhood(vector<int> & neighborhood) {
+    // a random intersection, i.e. a location with more than two neighbours
+    int center = -1;
+    uniform_int_distribution<int> location(0, ins.map_size() - 1);
+    for (int attempt = 0; attempt < 100 && center < 0; attempt++) {
+        int l = location(random);
+        if (!ins.blocked(l) && ins.get_adjacent_locations(l).size - 1 > 2) // minus wait
+            center = l;
+    }
+    if (center < 0)
+        return;
+
+    // rank the locations around it by distance, breadth first
+    unordered_map<int, int> rank;
+    queue<int> frontier;
+    rank[center] = 0;
+    frontier.push(center);
+    size_t region = (size_t)REGION_PER_AGENT * options.neighborhood_size;
+    while (!frontier.empty() && rank.size() < region) {
+        int l = frontier.front();
+        frontier.pop();
+        for (int next : ins.get_adjacent_locations(l))
+            if (rank.emplace(next, rank.size()).second)
+                frontier.push(next);
+    }
+
+    // the agents passing closest to it, ties broken at random
+    vector<pair<int, int>> closest; // (rank, agent)
+    for (int a = 0; a < ins.num_of_agents; a++) {
+        int best = INT_MAX;
+        for (int l : *paths[a]) {
+            auto it = rank.find(l);
+            if (it != rank.end())
+                best = min(best, it->second);
+        }
+        if (best < INT_MAX)
+            closest.emplace_back(best, a);
+    }
+    shuffle(closest.begin(), closest.end(), random);
+    stable_sort(closest.begin(), closest.end(),
+                [](const pair<int, int> & x, const pair<int, int> & y) { return x.first < y.first; });
+    for (int i = 0; i < (int)closest.size() && i < options.neighborhood_size; i++)
+        neighborhood.push_back(closest[i].second);
+}
+
+int LNS::replan(const vector<int> & neighborhood) {
+    vector<SharedPath> old_paths;
+    int old_cost = 0;
+    for (int a : neighborhood) {
+        old_paths.push_back(paths[a]);
+        old_cost += paths[a]->size();
+        paths[a] = nullptr;
+    }
+    auto restore = [&]() {
+        for (size_t i = 0; i < neighborhood.size(); i++)
+            paths[neighborhood[i]] = old_paths[i];
+        return 0;
+    };
+
+    vector<int> order(neighborhood);
+    shuffle(order.begin(), order.end(), random);
+    int new_cost = 0;
+    vector<Constraint> constraints;
+    for (int a : order) {
+        constraints.clear();
+        for (int other = 0; other < ins.num_of_agents; other++)
+            if (other != a && paths[other])
+                avoid_path(a, *paths[other], constraints);
+        Path path = find_path(a, constraints);
+        new_cost += path.size();
+        if (path.empty() || new_cost >= old_cost)
+            return restore(); // no path, or no improvement possible anymore
+        paths[a] = make_shared<const Path>(move(path));
+    }
+    return old_cost - new_cost;
+}
+
+Path LNS::find_path(int agent, const vector<Constraint> & constraints) {
+    return options.use_sipp ? sipp.find_path(agent, constraints.begin(), constraints.end())
+                            : a_star.find_path(agent, constraints.begin(), constraints.end());
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include "MAPFInstance.h"
+#include "AStarPlanner.h"
+#include "SIPPPlanner.h"
+#include "CollisionGrid.h"
+#include "PrioritizedPlanning.h"
+#include <chrono>
+#include <random>
+
+// How an LNS iteration chooses the agents to replan (see LNS.cpp)
+enum NeighborhoodType { RANDOM_NEIGHBORHOOD, AGENT_NEIGHBORHOOD, MAP_NEIGHBORHOOD, NEIGHBORHOOD_TYPES };
+
+struct LNSOptions {
+    double time_limit = 0;      // seconds spent improving the initial solution
+    int neighborhood_size = 8;  // agents replanned per iteration
+    unsigned seed = 0;
+    // SIPP by default: most replans of a crowded neighborhood fail, and SIPP proves that
+    // over a few safe intervals where A* has to search every (location, timestep) first
+    bool use_sipp = true;
+};
+
+// Anytime Large Neighborhood Search (MAPF-LNS): starting from a collision-free solution,
+// every iteration removes the paths of a few agents, replans them one after another
+// around the paths of all the others, and keeps the new paths if their sum of costs is
+// lower. Neighborhood types are chosen at random, weighted by how much each improved lately.
+class LNS {
+public:
+    LNS(const MAPFInstance& ins, const LNSOptions& options);
+
+    // improve paths, a collision-free solution, until the time limit;
+    // prints the sum of costs and the elapsed time after every iteration
+    void improve(vector<Path>& paths);
+
+private:
+    const MAPFInstance& ins;
+    LNSOptions options;
+    AStarPlanner a_star;
+    SIPPPlanner sipp;
+    mt19937 random;
+    double weights[NEIGHBORHOOD_TYPES];
+    vector<bool> tabu; // agents already chosen by the agent-based neighborhood since its last reset
+
+    vector<SharedPath> paths;
+
+    void random_neighborhood(vector<int>& neighborhood);
+    // agents in the way of the most delayed agent, met by random walks along its path
+    void agent_neighborhood(vector<int>& neighborhood);
+    // agents that pass through the region around a random intersection
+    void map_neighborhood(vector<int>& neighborhood);
+
+    // replan the neighborhood agents in random order around the other paths and keep
+    // the new paths if they cost less; returns the decrease in sum of costs, 0 if none
+    int replan(const vector<int>& neighborhood);
+    Path find_path(int agent, const vector<Constraint>& constraints);
+};
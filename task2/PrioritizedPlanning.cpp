@@ -0,0 +1,124 @@
+#include "PrioritizedPlanning.h"
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <set>
+
+constexpr int PrioritizedPlanning::SOLVED;
+constexpr int PrioritizedPlanning::ABANDONED;
+
+void avoid_path(int agent, const Path & path, vector<Constraint> & constraints) {
+    for (int t = 1; t < (int)path.size(); t++) {
+        constraints.emplace_back(agent, path[t], VERTEX_CONSTRAINT, t);
+        constraints.emplace_back(agent, path[t], path[t - 1], t);
+    }
+    if (!path.empty())
+        constraints.emplace_back(agent, path.back(), VERTEX_CONSTRAINT, -(int)path.size());
+}
+
+PrioritizedPlanning::PrioritizedPlanning(const MAPFInstance & ins, const PPOptions & options):
+        ins(ins), options(options), random(options.seed) {
+    int workers = max(1, options.threads);
+    a_star.reserve(workers);
+    sipp.reserve(workers);
+    for (int i = 0; i < workers; i++) {
+        a_star.emplace_back(ins);
+        sipp.emplace_back(ins);
+    }
+    if (workers > 1)
+        pool.reset(new ThreadPool(workers));
+}
+
+vector<Path> PrioritizedPlanning::find_solution() {
+    bool limited = options.time_limit > 0;
+    auto deadline = !limited ? chrono::steady_clock::time_point::max() : chrono::steady_clock::now()
+            + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(options.time_limit));
+
+    // orderings to try first; random ones fill the remaining workers
+    vector<int> by_index(ins.num_of_agents);
+    for (int a = 0; a < ins.num_of_agents; a++)
+        by_index[a] = a;
+    auto distance = [this](int a) { return ins.get_true_distance(ins.start_locations[a], ins.goal_locations[a]); };
+    vector<int> shortest_first(by_index), longest_first(by_index);
+    stable_sort(shortest_first.begin(), shortest_first.end(), [&](int x, int y) { return distance(x) < distance(y); });
+    stable_sort(longest_first.begin(), longest_first.end(), [&](int x, int y) { return distance(x) > distance(y); });
+    deque<vector<int>> pending = { by_index, shortest_first, longest_first };
+    set<vector<int>> tried;
+    int promotions = 0;
+
+    int workers = a_star.size();
+    vector<vector<int>> orders;
+    vector<vector<Path>> results(workers);
+    vector<int> outcomes(workers);
+    vector<Path> best;
+    int best_cost = INT_MAX;
+    while (chrono::steady_clock::now() < deadline && (best.empty() || options.anytime)) {
+        orders.clear();
+        while ((int)orders.size() < workers && !pending.empty()) {
+            if (tried.insert(pending.front()).second)
+                orders.push_back(move(pending.front()));
+            pending.pop_front();
+        }
+        for (int attempt = 0; limited && (int)orders.size() < workers && attempt < 2 * workers; attempt++) {
+            vector<int> order(by_index);
+            shuffle(order.begin(), order.end(), random);
+            if (tried.insert(order).second)
+                orders.push_back(move(order));
+        }
+        if (orders.empty())
+            break; // every ordering has been tried
+
+        run_tasks(pool.get(), orders.size(), [&](int i, int worker) {
+            outcomes[i] = plan(orders[i], worker, best_cost, deadline, results[i]);
+        });
+
+        for (size_t i = 0; i < orders.size(); i++) {
+            if (outcomes[i] == SOLVED) {
+                int cost = 0;
+                for (const Path & path : results[i])
+                    cost += path.size();
+                if (cost < best_cost) {
+                    best_cost = cost;
+                    best = results[i];
+                }
+            } else if (outcomes[i] != ABANDONED) {
+                if (outcomes[i] == orders[i].front()) {
+                    cout << "Fail to find any solutions for agent " << outcomes[i] << endl;
+                    return best; // it has no path even when planned first
+                }
+                if (!limited && promotions++ >= ins.num_of_agents)
+                    continue;
+                // plan the agent that failed before the ones that blocked it
+                vector<int> promoted(orders[i]);
+                promoted.erase(find(promoted.begin(), promoted.end(), outcomes[i]));
+                promoted.insert(promoted.begin(), outcomes[i]);
+                pending.push_back(move(promoted));
+            }
+        }
+    }
+    cout << "Tried " << tried.size() << " orderings" << endl;
+    return best;
+}
+
+int PrioritizedPlanning::plan(const vector<int> & order, int worker, int cost_bound,
+                              chrono::steady_clock::time_point deadline, vector<Path> & paths) {
+    paths.assign(ins.num_of_agents, Path());
+    vector<Constraint> constraints;
+    int cost = 0;
+    for (size_t i = 0; i < order.size(); i++) {
+        if (chrono::steady_clock::now() > deadline)
+            return ABANDONED;
+        int agent = order[i];
+        constraints.clear();
+        for (size_t j = 0; j < i; j++)
+            avoid_path(agent, paths[order[j]], constraints);
+        paths[agent] = options.use_sipp ? sipp[worker].find_path(agent, constraints.begin(), constraints.end())
+                                        : a_star[worker].find_path(agent, constraints.begin(), constraints.end());
+        if (paths[agent].empty())
+            return agent;
+        cost += paths[agent].size();
+        if (cost >= cost_bound)
+            return ABANDONED; // cannot beat the best solution so far
+    }
+    return SOLVED;
+}
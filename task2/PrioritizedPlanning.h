@@ -0,0 +1,50 @@
+#pragma once
+#include "MAPFInstance.h"
+#include "AStarPlanner.h"
+#include "SIPPPlanner.h"
+#include "ThreadPool.h"
+#include <chrono>
+#include <memory>
+#include <random>
+
+struct PPOptions {
+    bool use_sipp = false;
+    int threads = 1;         // orderings planned at the same time
+    double time_limit = 0;   // seconds; 0 for none, trying only the orderings below but no random ones
+    bool anytime = false;    // keep trying orderings until the time limit and return the cheapest solution
+    unsigned seed = 0;
+};
+
+// constraints that keep agent off path: its vertices and reversed moves, and its goal once it stays there
+void avoid_path(int agent, const Path& path, vector<Constraint>& constraints);
+
+// Prioritized planning: plans the agents one after another, each avoiding the paths of
+// the agents before it. Whether it succeeds, and at what cost, depends on the ordering,
+// so several are tried: index order, shortest and longest distance first, random ones,
+// and after a failure, the same ordering with the agent that failed moved to the front.
+// Random orderings are only tried under a time limit; without one, the search stops after
+// the orderings fixed in advance and at most one promotion per agent.
+// One ordering is planned per worker thread at a time.
+class PrioritizedPlanning {
+public:
+    PrioritizedPlanning(const MAPFInstance& ins, const PPOptions& options);
+
+    // empty if no ordering succeeded within the time limit
+    vector<Path> find_solution();
+
+private:
+    const MAPFInstance& ins;
+    PPOptions options;
+    // one low-level planner of each kind per worker, so workers never share search state
+    vector<AStarPlanner> a_star;
+    vector<SIPPPlanner> sipp;
+    unique_ptr<ThreadPool> pool; // nullptr when running sequentially
+    mt19937 random;
+
+    static constexpr int SOLVED = -1;
+    static constexpr int ABANDONED = -2;
+    // plan the agents in order into paths; SOLVED, ABANDONED once the sum of costs reaches
+    // cost_bound or the deadline passes, or else the first agent left without a path
+    int plan(const vector<int>& order, int worker, int cost_bound,
+             chrono::steady_clock::time_point deadline, vector<Path>& paths);
+};
@@ -1,14 +1,38 @@
 #include <iostream>
 #include <fstream>
 #include "MAPFInstance.h"
-#include "AStarPlanner.h"
-#include <tuple>
-#include <set>
+#include "PrioritizedPlanning.h"
+#include "LNS.h"
 
 int main(int argc, char *argv[]) {
     MAPFInstance ins;
     string input_file = argv[1];
     string output_file = argv[2];
+    PPOptions options;
+    LNSOptions lns_options;
+    for (int i = 3; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--sipp")
+            options.use_sipp = true; // use Safe Interval Path Planning as the low-level search
+        else if (option == "--threads" && i + 1 < argc)
+            options.threads = atoi(argv[++i]); // 0 uses every hardware thread
+        else if (option == "--time-limit" && i + 1 < argc) {
+            options.time_limit = atof(argv[++i]); // seconds spent on orderings, keeping the cheapest solution
+            options.anytime = true;
+        }
+        else if (option == "--lns" && i + 1 < argc)
+            lns_options.time_limit = atof(argv[++i]); // seconds of LNS improvement after planning
+        else if (option == "--lns-a-star")
+            lns_options.use_sipp = false; // replan LNS neighborhoods with A* rather than SIPP
+        else if (option == "--neighborhood-size" && i + 1 < argc)
+            lns_options.neighborhood_size = max(1, atoi(argv[++i]));
+        else if (option == "--seed" && i + 1 < argc)
+            options.seed = lns_options.seed = strtoul(argv[++i], nullptr, 10);
+        else
+            cout << "Ignoring unknown option " << option << endl;
+    }
+    if (options.threads <= 0)
+        options.threads = ThreadPool::hardware_threads();
     if (ins.load_instance(input_file)) {
         ins.print_instance();
     } else {
@@ -16,46 +40,16 @@ int main(int argc, char *argv[]) {
         exit(-1);
     }
 
-    AStarPlanner a_star(ins);
-    vector<Path> paths(ins.num_of_agents);
-
-    // assign priority ordering to agents
-    // By default, we use the index ordering of the agents where
-    // the first always has the highest priority.
-    list<int> priorities;
-    for (int i = 0; i < ins.num_of_agents; i++) {
-        priorities.push_back(i);
+    PrioritizedPlanning planner(ins, options);
+    vector<Path> paths = planner.find_solution();
+    if (paths.empty()) { // Fail to find solutions
+        cout << "No solutions!" << endl;
+        return 0;
     }
-    // reverse(priorities.begin(), priorities.end());
-
-    set<Constraint> constraints;
 
-    // plan paths
-    for (int i : priorities) {
-        paths[i] = a_star.find_path(i, constraints.begin(), constraints.end());
-
-        for (int a = 0; a < ins.num_of_agents; ++a) {
-            if (a != i) {
-                int t = 1;
-                for (t; t < paths[i].size(); ++t) {
-                    /* Vertex constraints */
-                    // int tv = paths[i][t] != ins.goal_locations[i] ? t : ALL_FUTURE_TIMESTEPS;
-                    constraints.emplace(a, paths[i][t], VERTEX_CONSTRAINT, t);
-                    /* Edge constraints */
-                    //constraints.emplace(a, paths[i][t-1], paths[i][t], t);
-                    constraints.emplace(a, paths[i][t], paths[i][t-1], t);
-                }
-
-                if (!paths[i].empty()) {
-                    constraints.emplace(a, paths[i].back(), VERTEX_CONSTRAINT, -t);
-                }
-            }
-        }
-
-        if (paths[i].empty()) {
-            cout << "Fail to find any solutions for agent " << i << endl;
-            return 0;
-        }
+    // improve the solution until the deadline
+    if (lns_options.time_limit > 0) {
+        LNS(ins, lns_options).improve(paths);
     }
 
     // print paths
@@ -66,6 +60,10 @@ int main(int argc, char *argv[]) {
         sum += paths[i].size();
     }
     cout << "Sum of cost: " << sum << endl;
+    cout << "Heuristic tables: " << ins.heuristics_built() << " built in " << ins.heuristic_seconds() << " s" << endl;
+#ifdef STATE_TABLE_STATS
+    cout << "State table probes: " << state_table_probes() << endl;
+#endif
 
     // save paths
     ofstream myfile (output_file.c_str(), ios_base::out);
@@ -1,8 +1,69 @@
 #include "CBS.h"
 #include <iostream>
 #include <queue>
+#include <algorithm>
+
+namespace {
+
+// true iff path breaks constraint
+bool violates(const Path & path, const Constraint & constraint) {
+    int t = getTimestep(constraint);
+    if (isLengthConstraint(constraint))
+        return (int)path.size() - 1 <= t;
+    if (allRemainingTimesteps(constraint)) { // vertex constraints from -t on
+        bool positive = isPositiveConstraint(constraint);
+        for (int i = -t; i < max((int)path.size(), -t + 1); i++)
+            if ((atOrBack<int>(path, i) == getFirstLocation(constraint)) != positive)
+                return true;
+        return false;
+    }
+    if (isPositiveConstraint(constraint))
+        return atOrBack<int>(path, t) != getFirstLocation(constraint);
+    if (isVertexConstraint(constraint))
+        return atOrBack<int>(path, t) == getFirstLocation(constraint);
+    return t > 0 && atOrBack<int>(path, t - 1) == getFirstLocation(constraint)
+        && atOrBack<int>(path, t) == getSecondLocation(constraint);
+}
+
+// true if constraint may remove paths from mdd (checked on the location entered at its timestep)
+bool prunes(const MDD & mdd, const Constraint & constraint) {
+    if (isLengthConstraint(constraint) || allRemainingTimesteps(constraint))
+        return true;
+    const vector<int> & level = mdd.get_level(min(getTimestep(constraint), mdd.depth() - 1));
+    if (isPositiveConstraint(constraint))
+        return level.size() > 1 || level[0] != getFirstLocation(constraint);
+    int entered = isVertexConstraint(constraint) ? getFirstLocation(constraint) : getSecondLocation(constraint);
+    return binary_search(level.begin(), level.end(), entered);
+}
+
+} // namespace
+
+CBS::CBS(const MAPFInstance& ins, const CBSOptions& options): ins(ins), options(options) {
+    int workers = max(1, options.threads);
+    a_star.reserve(workers);
+    sipp.reserve(workers);
+    for (int i = 0; i < workers; i++) {
+        a_star.emplace_back(ins);
+        sipp.emplace_back(ins);
+        cats.emplace_back(ins.map_size());
+    }
+    edge_weights.resize(workers);
+    if (is_bounded()) {
+        // ECBS only uses the focal A* search, and its node costs are not
+        // the optimal path lengths that the admissible heuristics assume
+        this->options.use_sipp = false;
+        this->options.heuristic = NO_HEURISTIC;
+    }
+    if (this->options.use_sipp)
+        this->options.disjoint_splitting = false; // safe intervals cannot express positive constraints
+    if (workers > 1)
+        pool.reset(new ThreadPool(workers));
+}
 
 vector<Path> CBS::find_solution() {
+    if (is_bounded())
+        return find_bounded_solution();
+
     priority_queue<CBSNode*, vector<CBSNode*>, CompareCBSNode> open; // open list
 
     /* generate the root CBS node */
@@ -11,50 +72,110 @@ vector<Path> CBS::find_solution() {
                                  // put it into all_nodes
                                  // so that we can release the memory properly later in ~CBS()
 
-    // find paths for the root node
-    root->paths.resize(a_star.ins.num_of_agents);
-    for (int i = 0; i < a_star.ins.num_of_agents; i++) {
-        // TODO: if you change the input format of function find_path()
-        //  you also need to change the following line to something like
-        //  root->paths[i] = a_star.find_path(i, list<Constraint>());
-        root->paths[i] = a_star.find_path(i, root->constraints.begin(), root->constraints.end());
-        if (root->paths[i].empty()) {
+    // find paths for the root node; the agents are independent here, so plan them concurrently
+    root->paths.resize(ins.num_of_agents);
+    root->mdds.resize(ins.num_of_agents);
+    root->constraint_keys.resize(ins.num_of_agents, 0);
+    vector<Constraint> no_constraints;
+    run_tasks(pool.get(), ins.num_of_agents, [&](int i, int worker) {
+        root->paths[i] = make_shared<const Path>(find_path(worker, i, no_constraints.begin(), no_constraints.end()));
+    });
+    for (int i = 0; i < ins.num_of_agents; i++) {
+        if (root->paths[i]->empty()) {
             cout << "Fail to find a path for agent " << i << endl;
             return vector<Path>(); // return "No solution"
         }
+        root->cost += root->paths[i]->size();
     }
-    // compute the cost of the root node
-    for (const auto& path : root->paths)
-        root->cost += path.size();
+
+    find_root_collisions(*root, CollisionGrid(root->paths));
+
+    root->h = compute_heuristic(*root, 0);
 
     // put the root node into open list
     open.push(root);
 
+    vector<CBSNode*> parents;
+    vector<unique_ptr<CollisionGrid>> grids;
+    vector<CBSNode*> children;
+    vector<size_t> child_parents; // index into parents of each child's parent
+    vector<char> generated; // not vector<bool>, workers write it concurrently
+    vector<CBSNode*> bypasses; // per parent, the child whose path it adopts, if any
     while (!open.empty()) {
-        auto p = open.top();
-        open.pop();
-
-        auto collision = find_collision(p->paths);
-        if (getFirstAgent(collision) == -1) {
-            return p->paths;
+        // take up to options.batch nodes with collisions; a collision-free node is only
+        // a solution when it is the cheapest one, so any later one goes back to open
+        parents.clear();
+        while (!open.empty() && (int)parents.size() < max(1, options.batch)) {
+            auto p = open.top();
+            if (p->collisions.empty() && !parents.empty())
+                break;
+            open.pop();
+            if (p->collisions.empty()) {
+                lower_bound = p->cost;
+                return get_paths(*p);
+            }
+            parents.push_back(p);
         }
+
         // constraints from collisions
-        auto new_constraints = get_constraints(collision);
-        for (const auto & constraint : new_constraints) {
-            auto q = new CBSNode(*p);
-            all_nodes.push_back(q);
-            q->constraints.insert(constraint);
-
-            int ai = getAgentId(constraint);
-            Path path = a_star.find_path(ai, q->constraints.begin(), q->constraints.end());
-            if (!path.empty()) {
-                q->paths[ai] = path;
-
-                for (Path inner_path : q->paths) {
-                    q->cost += inner_path.size();
+        children.clear();
+        child_parents.clear();
+        grids.clear();
+        for (size_t k = 0; k < parents.size(); k++) {
+            // children differ from their parent in a single path, so they share its grid
+            grids.emplace_back(new CollisionGrid(parents[k]->paths));
+            for (const auto & constraints : split(*parents[k], find_collision(*parents[k]))) {
+                children.push_back(new CBSNode(*parents[k], constraints));
+                child_parents.push_back(k);
+            }
+        }
+
+        // children are independent low-level searches on the same const instance
+        generated.assign(children.size(), 0);
+        auto generate = [&](int i, int worker) {
+            generated[i] = generate_child(*children[i], *grids[child_parents[i]], worker);
+        };
+        run_tasks(pool.get(), children.size(), generate);
+
+        // bypass: a child as cheap as its parent but with fewer collisions
+        // gives the parent its paths instead of being branched on
+        bypasses.assign(parents.size(), nullptr);
+        if (options.bypass) {
+            for (size_t i = 0; i < children.size(); i++) {
+                CBSNode* p = parents[child_parents[i]];
+                CBSNode*& best = bypasses[child_parents[i]];
+                if (generated[i] && children[i]->cost == p->cost
+                        && children[i]->collisions.size() < (best ? best : p)->collisions.size())
+                    best = children[i];
+            }
+            for (size_t k = 0; k < parents.size(); k++) {
+                if (bypasses[k] == nullptr)
+                    continue;
+                CBSNode* p = parents[k];
+                for (int a = 0; a < ins.num_of_agents; a++) {
+                    if (p->paths[a] == bypasses[k]->paths[a])
+                        continue;
+                    // p has a subset of the child's constraints, so its MDD still applies at the same length
+                    if (p->paths[a]->size() != bypasses[k]->paths[a]->size())
+                        p->mdds[a].reset();
+                    p->paths[a] = bypasses[k]->paths[a];
                 }
+                parents[k]->collisions = bypasses[k]->collisions;
+                parents[k]->h = compute_heuristic(*parents[k], 0);
+            }
+        }
 
-                open.push(q);
+        // push in generation order so the search does not depend on thread timing;
+        // children that are not pushed are released right away
+        for (size_t k = 0; k < parents.size(); k++)
+            if (bypasses[k])
+                open.push(parents[k]);
+        for (size_t i = 0; i < children.size(); i++) {
+            if (generated[i] && bypasses[child_parents[i]] == nullptr) {
+                all_nodes.push_back(children[i]); // whenever a node is kept, it goes into all_nodes
+                open.push(children[i]);
+            } else {
+                delete children[i];
             }
         }
     }
@@ -62,45 +183,213 @@ vector<Path> CBS::find_solution() {
     return vector<Path>(); // return "No solution"
 }
 
-Collision CBS::find_collision(const vector<Path> & paths) const {
-    int a1_at_t, a1_bf_t, a2_at_t, a2_bf_t;
+bool CBS::generate_child(CBSNode & child, const CollisionGrid & grid, int worker) {
+    vector<int> replanned;
+    vector<Constraint> added;
+    for (int agent = 0; agent < ins.num_of_agents; agent++) {
+        added.clear();
+        CBSNode::implied_constraints(child.constraints, agent, added);
+        if (added.empty())
+            continue;
+        child.constraint_keys[agent] = CBSNode::extend_key(child.constraint_keys[agent], added);
+        bool violated = false;
+        for (const auto & constraint : added)
+            violated = violated || violates(*child.paths[agent], constraint);
+        if (violated) {
+            if (!replan(child, agent, worker))
+                return false;
+            replanned.push_back(agent);
+            continue;
+        }
+        // the path still fits, but the new constraints may prune the agent's MDD
+        for (const auto & constraint : added)
+            if (child.mdds[agent] && prunes(*child.mdds[agent], constraint))
+                child.mdds[agent].reset();
+    }
 
-    int timesteps = max_element(paths.begin(), paths.end(), 
-            [](const Path & p1, const Path & p2) { return p1.size() < p2.size(); }
-        )->size();
+    if (replanned.size() == 1) {
+        update_collisions(child, replanned, grid);
+    } else {
+        CollisionGrid child_grid(child.paths); // the parent's grid misses the other replanned paths
+        update_collisions(child, replanned, child_grid);
+    }
+    child.h = compute_heuristic(child, worker);
+    return true;
+}
 
-    for (int t = 0; t < timesteps; ++t) {
-        // vertex collisions
-        for (int a1 = 0; a1 < paths.size(); ++a1) {
-            a1_at_t = atOrBack<int>(paths[a1], t);
-            for (int a2 = a1 + 1; a2 < paths.size(); ++a2) {
-                a2_at_t = atOrBack<int>(paths[a2], t);
-                if (a1_at_t == a2_at_t) {
-                    return Collision(true, a1, a2, t, a1_at_t, -1);
-                }
-            }
+bool CBS::replan(CBSNode & child, int agent, int worker) {
+    vector<Constraint> agent_constraints = child.collect_constraints(agent);
+    // the child still holds the parent's paths, which mostly match what this worker's table
+    // held last, so syncing only touches a few paths
+    ConflictAvoidanceTable & cat = cats[worker];
+    if (options.avoid_conflicts || is_bounded())
+        cat.sync(child.paths, agent);
+    Path path;
+    if (is_bounded()) {
+        int agent_lower_bound;
+        path = a_star[worker].find_bounded_path(agent, agent_constraints.begin(), agent_constraints.end(),
+                                                options.suboptimality, cat, agent_lower_bound);
+        if (path.empty())
+            return false;
+        // the child has more constraints than its parent, so the parent's bound still holds
+        agent_lower_bound = max(agent_lower_bound, child.lower_bounds[agent]);
+        child.lower_bound += agent_lower_bound - child.lower_bounds[agent];
+        child.lower_bounds[agent] = agent_lower_bound;
+    } else {
+        path = find_path(worker, agent, agent_constraints.begin(), agent_constraints.end(),
+                         options.avoid_conflicts ? &cat : nullptr);
+        if (path.empty())
+            return false;
+    }
+    child.cost += (int)path.size() - (int)child.paths[agent]->size();
+    child.paths[agent] = make_shared<const Path>(move(path));
+    child.mdds[agent].reset(); // new constraints, so the parent's MDD no longer applies
+    return true;
+}
+
+vector<Path> CBS::get_paths(const CBSNode & node) const {
+    vector<Path> paths;
+    for (const auto & path : node.paths)
+        paths.push_back(*path);
+    return paths;
+}
+
+void CBS::find_root_collisions(CBSNode & root, const CollisionGrid & grid) const {
+    vector<Collision> agent_collisions;
+    for (int i = 0; i < ins.num_of_agents; i++) {
+        agent_collisions.clear();
+        grid.find_collisions(i, *root.paths[i], agent_collisions);
+        for (const auto & collision : agent_collisions)
+            if (getSecondAgent(collision) > i)
+                root.collisions.push_back(collision);
+    }
+}
+
+Collision CBS::find_collision(CBSNode & node) const {
+    auto earlier = [](const Collision & c1, const Collision & c2) {
+        return getTimestep(c1) < getTimestep(c2)
+            || (getTimestep(c1) == getTimestep(c2) && isVertex(c1) && !isVertex(c2));
+    };
+    if (!options.prioritize_collisions)
+        return *min_element(node.collisions.begin(), node.collisions.end(), earlier);
+
+    const Collision * best = nullptr;
+    CollisionType best_type = NON_CARDINAL;
+    for (const auto & collision : node.collisions) {
+        CollisionType type = classify_collision(node, collision);
+        if (best == nullptr || type < best_type || (type == best_type && earlier(collision, *best))) {
+            best = &collision;
+            best_type = type;
         }
     }
+    return *best;
+}
 
-    for (int t = 1; t < timesteps; ++t) {
-        // edge collisions
-        for (int a1 = 0; a1 < paths.size(); ++a1) {
-            a1_at_t = atOrBack<int>(paths[a1], t);
-            a1_bf_t = atOrBack<int>(paths[a1], t-1);
+CollisionType CBS::classify_collision(CBSNode & node, const Collision & collision) const {
+    int t = getTimestep(collision);
+    int cardinal_agents = 0;
+    for (int agent : { getFirstAgent(collision), getSecondAgent(collision) }) {
+        const MDD & mdd = get_mdd(node, agent);
+        // the agent cannot avoid the collision without a longer path
+        // iff its MDD has no alternative at the collision timestep(s)
+        if (mdd.is_singleton(t) && (isVertex(collision) || mdd.is_singleton(t - 1)))
+            cardinal_agents++;
+    }
+    return cardinal_agents == 2 ? CARDINAL : cardinal_agents == 1 ? SEMI_CARDINAL : NON_CARDINAL;
+}
 
-            for (int a2 = a1 + 1; a2 < paths.size(); ++a2) {
-                a2_at_t = atOrBack<int>(paths[a2], t);
-                a2_bf_t = atOrBack<int>(paths[a2], t-1);
+const MDD & CBS::get_mdd(CBSNode & node, int agent) const {
+    if (!node.mdds[agent]) {
+        vector<Constraint> agent_constraints = node.collect_constraints(agent);
+        ConstraintTable table;
+        table.build(agent, ins.goal_locations[agent], agent_constraints.begin(), agent_constraints.end());
+        node.mdds[agent] = make_shared<const MDD>(ins, agent, node.paths[agent]->size(), table);
+    }
+    return *node.mdds[agent];
+}
 
-                if (a1_at_t == a2_bf_t && a1_bf_t == a2_at_t) 
-                {
-                    return Collision(false, a1, a2, t, a1_bf_t, a1_at_t);
-                }
-            }
+void CBS::update_collisions(CBSNode & node, const vector<int> & agents, const CollisionGrid & grid) const {
+    auto replanned = [&agents](int agent) { return find(agents.begin(), agents.end(), agent) != agents.end(); };
+    node.collisions.erase(remove_if(node.collisions.begin(), node.collisions.end(),
+        [&replanned](const Collision & collision) {
+            return replanned(getFirstAgent(collision)) || replanned(getSecondAgent(collision));
         }
+    ), node.collisions.end());
+    vector<Collision> agent_collisions;
+    for (int agent : agents) {
+        agent_collisions.clear();
+        grid.find_collisions(agent, *node.paths[agent], agent_collisions);
+        for (const auto & collision : agent_collisions) // pairs of replanned agents are found twice
+            if (!replanned(getSecondAgent(collision)) || getSecondAgent(collision) > agent)
+                node.collisions.push_back(collision);
+    }
+}
+
+vector<Constraint> CBSNode::collect_constraints(int agent) const {
+    vector<Constraint> constraints;
+    for (const CBSNode* node = this; node != nullptr; node = node->parent)
+        implied_constraints(node->constraints, agent, constraints);
+    return constraints;
+}
+
+void CBSNode::implied_constraints(const vector<Constraint>& added, int agent, vector<Constraint>& constraints) {
+    if (added.empty())
+        return;
+    const Constraint & first = added.front();
+    if (getAgentId(first) == agent) {
+        constraints.insert(constraints.end(), added.begin(), added.end());
+        return;
     }
+    if (!isPositiveConstraint(first))
+        return;
+    // another agent must be at these locations: nobody else may be there then
+    // (from the same timestep on, for a positive constraint on all remaining timesteps)
+    for (const auto & constraint : added)
+        constraints.emplace_back(agent, getFirstLocation(constraint), VERTEX_CONSTRAINT, getTimestep(constraint));
+    // nor cross its move in the opposite direction
+    if (added.size() == 2) {
+        const Constraint & second = added.back();
+        constraints.emplace_back(agent, getFirstLocation(second), getFirstLocation(first), getTimestep(second));
+    }
+}
 
-    return Collision(false, -1, -1, -1, -1, -1);
+bool CBS::invalidates(const CBSNode & node, const vector<Constraint> & added) const {
+    vector<Constraint> implied;
+    for (int agent = 0; agent < ins.num_of_agents; agent++) {
+        implied.clear();
+        CBSNode::implied_constraints(added, agent, implied);
+        for (const auto & constraint : implied)
+            if (violates(*node.paths[agent], constraint))
+                return true;
+    }
+    return false;
+}
+
+vector<vector<Constraint>> CBS::split(const CBSNode & node, const Collision & collision) const {
+    // symmetric collisions are resolved in a single split, see CBSSymmetry.cpp
+    vector<vector<Constraint>> children;
+    if (options.symmetry_reasoning && (split_target(node, collision, children)
+            || split_corridor(node, collision, children) || split_rectangle(node, collision, children)))
+        return children;
+
+    vector<Constraint> negative = get_constraints(collision);
+    if (!options.disjoint_splitting)
+        return { { negative[0] }, { negative[1] } };
+
+    // disjoint splitting: the first agent either must or must not be where it collides,
+    // so no solution lies below both children
+    int agent = getFirstAgent(collision);
+    int timestep = getTimestep(collision);
+    vector<Constraint> positive;
+    if (isVertex(collision)) {
+        positive = { Constraint(agent, getFirstPosition(collision), POSITIVE_VERTEX_CONSTRAINT, timestep) };
+    } else {
+        positive = {
+            Constraint(agent, getFirstPosition(collision), POSITIVE_VERTEX_CONSTRAINT, timestep - 1),
+            Constraint(agent, getSecondPosition(collision), POSITIVE_VERTEX_CONSTRAINT, timestep)
+        };
+    }
+    return { positive, { negative[0] } };
 }
 
 vector<Constraint> CBS::get_constraints(const Collision & collision) const {
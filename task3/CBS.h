@@ -1,56 +1,181 @@
 #pragma once
 #include "AStarPlanner.h"
-#include <set>
-
-using Collision = tuple<bool, int, int, int, int, int>;
-// struct Collision {
-//     bool isVertex;
-//     int firstAgent;
-//     int secondAgent;
-//     int timestep;
-//     int firstPosition;
-//     int secondPosition;
-// };
-inline bool isVertex(Collision c) { return get<0>(c); }
-inline int getFirstAgent(Collision c) { return get<1>(c); }
-inline int getSecondAgent(Collision c) { return get<2>(c); }
-inline int getTimestep(Collision c) { return get<3>(c); }
-inline int getFirstPosition(Collision c) { return get<4>(c); }
-inline int getSecondPosition(Collision c) { return get<5>(c); }
+#include "SIPPPlanner.h"
+#include "ThreadPool.h"
+#include "MDD.h"
+#include "CollisionGrid.h"
+#include <unordered_map>
+#include <memory>
+#include <map>
 
+// A collision is cardinal if splitting on it increases the cost of both children,
+// semi-cardinal if it increases the cost of one, and non-cardinal otherwise
+enum CollisionType { CARDINAL, SEMI_CARDINAL, NON_CARDINAL };
+
+// Admissible estimate of how much a node's cost must still grow, from a graph over its agents:
+// conflict graph (edges for cardinal collisions), pairwise dependency graph (edges for pairs
+// without a joint conflict-free path at their current costs), or weighted dependency graph
+// (edges weighted by the extra cost of solving the pair optimally)
+enum HeuristicType { NO_HEURISTIC, CG_HEURISTIC, DG_HEURISTIC, WDG_HEURISTIC };
+
+// A node stores only the constraints it adds to its parent; the full constraint set
+// is the chain of constraints up to the root. Paths are shared with the parent
+// except for the agents replanned in this node.
 struct CBSNode {
-    set<Constraint> constraints;
-    vector<Path> paths;
+    const CBSNode* parent;        // nullptr at the root
+    // all on one agent: a negative constraint, or with disjoint splitting one or two
+    // positive ones (two for a move, at consecutive timesteps), or with symmetry reasoning
+    // a length constraint, a positive one from a timestep on, or a set of vertex
+    // constraints (a range of timesteps at one location, or a barrier); empty at the root
+    vector<Constraint> constraints;
+    vector<SharedPath> paths;
+    vector<Collision> collisions; // first collision of every colliding pair of agents
+    // MDDs of the agents' current paths, built on demand and shared with children
+    // whose constraints and path for that agent are unchanged
+    vector<shared_ptr<const MDD>> mdds;
+    // per agent, a hash of the chain of constraints on it from the root; equal keys mean
+    // equal constraints, so results that depend on nothing else can be shared across nodes
+    vector<uint64_t> constraint_keys;
     int cost;
+    int h; // admissible estimate of the remaining cost increase
+    // bounded search only: per-agent and total lower bounds on the cost of any solution below this node
+    vector<int> lower_bounds;
+    int lower_bound;
 
-    CBSNode(): cost(0) {}
+    CBSNode(): parent(nullptr), cost(0), h(0), lower_bound(0) {}
 
     // this constructor helps to generate child nodes
-    CBSNode(const CBSNode& parent):
-            constraints(parent.constraints), paths(parent.paths), cost(0) {}
+    CBSNode(const CBSNode& parent, const vector<Constraint>& constraints):
+            parent(&parent), constraints(constraints), paths(parent.paths), collisions(parent.collisions),
+            mdds(parent.mdds), constraint_keys(parent.constraint_keys), cost(parent.cost), h(0), lower_bounds(parent.lower_bounds),
+            lower_bound(parent.lower_bound) {}
+
+    // constraints on agent from this node and all its ancestors
+    vector<Constraint> collect_constraints(int agent) const;
+    // append the constraints that added (one node's constraints) impose on agent: themselves
+    // if they are on agent, otherwise the negative constraints implied by positive ones
+    static void implied_constraints(const vector<Constraint>& added, int agent, vector<Constraint>& constraints);
+
+    // constraint key of an agent after the constraints added (as implied on it) to key
+    static inline uint64_t extend_key(uint64_t key, const vector<Constraint>& added) {
+        hash_constraint hash;
+        for (const auto& constraint : added)
+            key = (key ^ hash(constraint)) * 0x9E3779B97F4A7C15ULL;
+        return key;
+    }
 };
 
 // This function is used by priority_queue to prioritize CBS nodes
 struct CompareCBSNode {
     bool operator()(const CBSNode* n1, const CBSNode* n2) {
-        return n1->cost > n2->cost; // prefer smaller cost
+        if (n1->cost + n1->h == n2->cost + n2->h) // if both nodes have the same f value,
+            return n1->collisions.size() > n2->collisions.size(); // prefer fewer collisions
+        return n1->cost + n1->h > n2->cost + n2->h; // otherwise, prefer smaller f value
+    }
+};
+
+struct CBSOptions {
+    bool use_sipp = false; // plan with SIPP instead of space-time A*
+    int threads = 1;       // worker threads generating child nodes; 1 runs sequentially
+    int batch = 1;         // nodes taken from the top of open per iteration
+    bool prioritize_collisions = true; // split on cardinal, then semi-cardinal collisions first (ICBS)
+    HeuristicType heuristic = NO_HEURISTIC;
+    bool bypass = true;    // adopt a child's path into its parent when it has the same cost and fewer collisions
+    bool disjoint_splitting = true; // split into a positive and a negative constraint on one agent
+    bool symmetry_reasoning = true; // resolve target, corridor and rectangle collisions in one split
+    bool avoid_conflicts = true; // break low-level f ties towards fewer collisions with the other paths
+    // w >= 1; above 1, search with ECBS for a solution costing at most w times the optimum
+    double suboptimality = 1.0;
+};
+
+// Orders the focal list of ECBS: fewest collisions, then smallest cost
+struct CompareFocalCBSNode {
+    bool operator()(const CBSNode* n1, const CBSNode* n2) {
+        if (n1->collisions.size() == n2->collisions.size())
+            return n1->cost > n2->cost;
+        return n1->collisions.size() > n2->collisions.size();
     }
 };
 
 class CBS {
 public:
     vector<Path> find_solution();
-    explicit CBS(const MAPFInstance& ins): a_star(ins) {}
+    // cost no solution can beat, proven by the last successful find_solution
+    inline int get_lower_bound() const { return lower_bound; }
+    explicit CBS(const MAPFInstance& ins, const CBSOptions& options = CBSOptions());
     ~CBS();
 
 private:
-    AStarPlanner a_star;
+    const MAPFInstance& ins;
+    CBSOptions options;
+
+    // one low-level planner of each kind per worker, so workers never share search state
+    vector<AStarPlanner> a_star;
+    vector<SIPPPlanner> sipp;
+    unique_ptr<ThreadPool> pool; // nullptr when running sequentially
+    // one conflict avoidance table per worker, synced to the node being replanned
+    vector<ConflictAvoidanceTable> cats;
+    int lower_bound = 0;
+
+    // SIPP does not use the conflict avoidance table
+    template <class Iterator>
+    inline Path find_path(int worker, int agent_id, Iterator constraints_begin, Iterator constraints_end,
+                          const ConflictAvoidanceTable* cat = nullptr) {
+        return options.use_sipp ? sipp[worker].find_path(agent_id, constraints_begin, constraints_end)
+                                : a_star[worker].find_path(agent_id, constraints_begin, constraints_end, cat);
+    }
 
     // all_nodes stores the pointers to CBS nodes
     // so that we can release the memory properly when
     // calling the destructor ~CBS()
     list<CBSNode*> all_nodes;
 
-    Collision find_collision(const vector<Path> & paths) const;
+    // ECBS: focal search over CBS nodes using focal low-level searches, see ECBS.cpp
+    vector<Path> find_bounded_solution();
+    inline bool is_bounded() const { return options.suboptimality > 1.0; }
+    vector<Path> get_paths(const CBSNode & node) const;
+    // collisions of the root node, each pair of agents counted once
+    void find_root_collisions(CBSNode & root, const CollisionGrid & grid) const;
+
+    // replan every agent whose path violates the child's new constraints; false if one has no path
+    bool generate_child(CBSNode & child, const CollisionGrid & grid, int worker);
+    bool replan(CBSNode & child, int agent, int worker);
+    // the constraint sets of the two children of a split on collision in node
+    vector<vector<Constraint>> split(const CBSNode & node, const Collision & collision) const;
+    // true iff some path of node breaks the constraints added
+    bool invalidates(const CBSNode & node, const vector<Constraint> & added) const;
+
+    // symmetry reasoning, see CBSSymmetry.cpp; each fills children and returns true if it applies
+    bool split_target(const CBSNode & node, const Collision & collision, vector<vector<Constraint>> & children) const;
+    bool split_corridor(const CBSNode & node, const Collision & collision, vector<vector<Constraint>> & children) const;
+    bool split_rectangle(const CBSNode & node, const Collision & collision, vector<vector<Constraint>> & children) const;
+    // collision to split on: the earliest collision of the most cardinal type,
+    // vertex collisions first on ties
+    Collision find_collision(CBSNode & node) const;
+    CollisionType classify_collision(CBSNode & node, const Collision & collision) const;
+    const MDD & get_mdd(CBSNode & node, int agent) const;
+
+    // high-level heuristics, see CBSHeuristic.cpp
+    int compute_heuristic(CBSNode & node, int worker);
+    bool are_dependent(CBSNode & node, int a1, int a2) const;
+    int pair_cost_increase(CBSNode & node, int a1, int a2, int worker);
+    // DG/WDG edge weight (0 if independent) per pair of agents and their constraint keys,
+    // which determine the weight; one cache per worker, emptied when it grows too large (see CBSHeuristic.cpp)
+    struct PairKey {
+        int a1, a2;
+        uint64_t key1, key2;
+        bool operator==(const PairKey& other) const {
+            return a1 == other.a1 && a2 == other.a2 && key1 == other.key1 && key2 == other.key2;
+        }
+    };
+    struct HashPairKey {
+        size_t operator()(const PairKey& k) const {
+            return (k.key1 * 31 + k.key2) ^ ((uint64_t)(uint32_t)k.a1 << 32 | (uint32_t)k.a2);
+        }
+    };
+    vector<unordered_map<PairKey, int, HashPairKey>> edge_weights;
+    // recompute the collisions of agents after their paths in node were replaced;
+    // grid must hold node's paths of every other agent
+    void update_collisions(CBSNode & node, const vector<int> & agents, const CollisionGrid & grid) const;
     vector<Constraint> get_constraints(const Collision & collision) const;
 };
@@ -0,0 +1,242 @@
+#include "CBS.h"
+#include <algorithm>
+#include <queue>
+
+// Components larger than this are not solved exactly; a matching bound is used instead
+constexpr int MAX_EXACT_COVER_SIZE = 16;
+// High-level expansions allowed when solving a pair of agents for a WDG edge weight
+constexpr int MAX_PAIR_EXPANSIONS = 64;
+// Edge weights cached per worker before its cache is emptied
+constexpr size_t MAX_CACHED_WEIGHTS = 1 << 18;
+
+namespace {
+
+// Dependency graph over the agents of a node; weight[i][j] > 0 iff i and j are connected
+struct WeightedGraph {
+    vector<int> agents;
+    vector<vector<int>> weight;
+
+    int add_agent(int agent) {
+        auto it = find(agents.begin(), agents.end(), agent);
+        if (it != agents.end())
+            return it - agents.begin();
+        agents.push_back(agent);
+        for (auto& row : weight)
+            row.push_back(0);
+        weight.emplace_back(agents.size(), 0);
+        return agents.size() - 1;
+    }
+
+    void add_edge(int a1, int a2, int w) {
+        int i = add_agent(a1), j = add_agent(a2);
+        weight[i][j] = weight[j][i] = max(weight[i][j], w);
+    }
+};
+
+// Exact edge-weighted minimum vertex cover of one component by depth-first search:
+// every vertex gets a value x such that x[i] + x[j] >= weight[i][j] for every edge
+void cover_search(const WeightedGraph& graph, const vector<int>& component, size_t depth,
+                  vector<int>& x, int sum, int& best) {
+    if (sum >= best)
+        return;
+    if (depth == component.size()) {
+        best = sum;
+        return;
+    }
+    int v = component[depth];
+    int lower = 0, upper = 0;
+    for (size_t d = 0; d < component.size(); d++) {
+        int u = component[d];
+        upper = max(upper, graph.weight[v][u]);
+        if (d < depth)
+            lower = max(lower, graph.weight[v][u] - x[u]);
+    }
+    for (int value = lower; value <= upper; value++) {
+        x[v] = value;
+        cover_search(graph, component, depth + 1, x, sum + value, best);
+    }
+    x[v] = 0;
+}
+
+// Admissible lower bound for large components: edges of a greedy matching share no vertex,
+// so each needs its own weight in any cover
+int matching_bound(const WeightedGraph& graph, const vector<int>& component) {
+    vector<bool> matched(graph.agents.size(), false);
+    int bound = 0;
+    for (int v : component) {
+        if (matched[v])
+            continue;
+        int best_u = -1;
+        for (int u : component)
+            if (!matched[u] && u != v && graph.weight[v][u] > 0
+                && (best_u < 0 || graph.weight[v][u] > graph.weight[v][best_u]))
+                best_u = u;
+        if (best_u >= 0) {
+            matched[v] = matched[best_u] = true;
+            bound += graph.weight[v][best_u];
+        }
+    }
+    return bound;
+}
+
+int minimum_vertex_cover(const WeightedGraph& graph) {
+    int n = graph.agents.size();
+    vector<bool> visited(n, false);
+    vector<int> x(n, 0);
+    int total = 0;
+    for (int start = 0; start < n; start++) {
+        if (visited[start])
+            continue;
+        vector<int> component = { start };
+        visited[start] = true;
+        for (size_t k = 0; k < component.size(); k++)
+            for (int u = 0; u < n; u++)
+                if (!visited[u] && graph.weight[component[k]][u] > 0) {
+                    visited[u] = true;
+                    component.push_back(u);
+                }
+        if (component.size() == 1)
+            continue;
+        if ((int)component.size() > MAX_EXACT_COVER_SIZE) {
+            total += matching_bound(graph, component);
+        } else {
+            int best = INT_MAX;
+            cover_search(graph, component, 0, x, 0, best);
+            total += best;
+        }
+    }
+    return total;
+}
+
+// first collision between two paths, reported for agents a1 and a2
+Collision first_collision(int a1, const Path& p1, int a2, const Path& p2) {
+    int timesteps = max(p1.size(), p2.size());
+    for (int t = 0; t < timesteps; t++) {
+        if (atOrBack<int>(p1, t) == atOrBack<int>(p2, t))
+            return Collision(true, a1, a2, t, atOrBack<int>(p1, t), -1);
+        if (t > 0 && atOrBack<int>(p1, t) == atOrBack<int>(p2, t - 1) && atOrBack<int>(p1, t - 1) == atOrBack<int>(p2, t)
+            && atOrBack<int>(p1, t) != atOrBack<int>(p1, t - 1))
+            return Collision(false, a1, a2, t, atOrBack<int>(p1, t - 1), atOrBack<int>(p1, t));
+    }
+    return Collision(false, -1, -1, -1, -1, -1);
+}
+
+} // namespace
+
+int CBS::compute_heuristic(CBSNode & node, int worker) {
+    if (options.heuristic == NO_HEURISTIC || node.collisions.empty())
+        return 0;
+
+    WeightedGraph graph;
+    for (const auto & collision : node.collisions) {
+        int a1 = min(getFirstAgent(collision), getSecondAgent(collision));
+        int a2 = max(getFirstAgent(collision), getSecondAgent(collision));
+        if (options.heuristic == CG_HEURISTIC) {
+            if (classify_collision(node, collision) == CARDINAL)
+                graph.add_edge(a1, a2, 1);
+            continue;
+        }
+
+        // the MDDs and the pair's optimal cost only depend on the two agents' constraints
+        PairKey key = { a1, a2, node.constraint_keys[a1], node.constraint_keys[a2] };
+        auto & cache = edge_weights[worker];
+        auto cached = cache.find(key);
+        int weight;
+        if (cached != cache.end()) {
+            weight = cached->second;
+        } else {
+            weight = 0;
+            if (classify_collision(node, collision) == CARDINAL || are_dependent(node, a1, a2))
+                weight = options.heuristic == WDG_HEURISTIC ? pair_cost_increase(node, a1, a2, worker) : 1;
+            if (cache.size() >= MAX_CACHED_WEIGHTS)
+                cache.clear();
+            cache[key] = weight;
+        }
+        if (weight > 0)
+            graph.add_edge(a1, a2, weight);
+    }
+    return minimum_vertex_cover(graph);
+}
+
+// Two agents are dependent iff no pair of paths from their MDDs avoids each other.
+// Edge constraints are not rechecked on MDD edges, which can only hide a dependency,
+// so the heuristic stays admissible.
+bool CBS::are_dependent(CBSNode & node, int a1, int a2) const {
+    const MDD & mdd1 = get_mdd(node, a1);
+    const MDD & mdd2 = get_mdd(node, a2);
+    int depth = max(mdd1.depth(), mdd2.depth());
+    auto level = [](const MDD & mdd, int t) -> const vector<int>& {
+        return mdd.get_level(min(t, mdd.depth() - 1)); // agents wait at their goals
+    };
+    auto adjacent = [this](int from, int to) { // MDD locations are never blocked
+        return ins.get_Manhattan_distance(from, to) <= 1;
+    };
+
+    vector<pair<int, int>> frontier = { make_pair(level(mdd1, 0)[0], level(mdd2, 0)[0]) };
+    for (int t = 1; t < depth && !frontier.empty(); t++) {
+        vector<pair<int, int>> next_frontier;
+        for (const auto & state : frontier) {
+            for (int l1 : level(mdd1, t)) {
+                if (!adjacent(state.first, l1))
+                    continue;
+                for (int l2 : level(mdd2, t)) {
+                    if (l1 == l2 || (l1 == state.second && l2 == state.first) || !adjacent(state.second, l2))
+                        continue; // vertex or swap collision
+                    next_frontier.emplace_back(l1, l2);
+                }
+            }
+        }
+        sort(next_frontier.begin(), next_frontier.end());
+        next_frontier.erase(unique(next_frontier.begin(), next_frontier.end()), next_frontier.end());
+        frontier.swap(next_frontier);
+    }
+    return frontier.empty();
+}
+
+// Extra cost of resolving the pair optimally under the node's constraints, found by a CBS
+// over the two agents. If it runs out of expansions, the cheapest unexpanded pair node
+// is still a lower bound.
+int CBS::pair_cost_increase(CBSNode & node, int a1, int a2, int worker) {
+    struct PairNode {
+        vector<Constraint> constraints[2];
+        Path paths[2];
+        int cost;
+    };
+    const int agents[2] = { a1, a2 };
+    int base_cost = node.paths[a1]->size() + node.paths[a2]->size();
+
+    vector<PairNode> nodes(1);
+    for (int k = 0; k < 2; k++) {
+        nodes[0].constraints[k] = node.collect_constraints(agents[k]);
+        nodes[0].paths[k] = *node.paths[agents[k]];
+    }
+    nodes[0].cost = base_cost;
+
+    auto compare = [&nodes](size_t i, size_t j) { return nodes[i].cost > nodes[j].cost; };
+    priority_queue<size_t, vector<size_t>, decltype(compare)> open(compare);
+    open.push(0);
+    for (int expansions = 0; !open.empty(); expansions++) {
+        size_t p = open.top();
+        if (expansions == MAX_PAIR_EXPANSIONS)
+            return max(1, nodes[p].cost - base_cost);
+        open.pop();
+
+        Collision collision = first_collision(a1, nodes[p].paths[0], a2, nodes[p].paths[1]);
+        if (getFirstAgent(collision) == -1)
+            return max(1, nodes[p].cost - base_cost);
+
+        for (const auto & constraint : get_constraints(collision)) {
+            int k = getAgentId(constraint) == a1 ? 0 : 1;
+            PairNode child = nodes[p];
+            child.constraints[k].push_back(constraint);
+            Path path = find_path(worker, agents[k], child.constraints[k].begin(), child.constraints[k].end());
+            if (path.empty())
+                continue;
+            child.cost += (int)path.size() - (int)child.paths[k].size();
+            child.paths[k] = move(path);
+            nodes.push_back(move(child));
+            open.push(nodes.size() - 1);
+        }
+    }
+    return 1; // the pair has no solution here; any positive weight is admissible
+}
@@ -0,0 +1,172 @@
+#include "CBS.h"
+#include <algorithm>
+
+// Symmetric collisions can be resolved by plain splitting only one timestep at a time:
+// each child delays one agent by a step and collides again. The splits below rule out
+// every such variant at once, and still keep every collision-free solution in a child.
+
+namespace {
+
+inline int sign(int x) { return (x > 0) - (x < 0); }
+
+// agent must not be at location at any timestep in [0, last]
+vector<Constraint> range_constraint(int agent, int location, int last) {
+    vector<Constraint> constraints;
+    for (int t = 0; t <= last; t++)
+        constraints.emplace_back(agent, location, VERTEX_CONSTRAINT, t);
+    return constraints;
+}
+
+} // namespace
+
+// Target collision: an agent steps on the goal of another that has already finished there.
+// Either the finished agent finishes later, or it is at its goal from that timestep on
+// and nobody else may enter the goal from then on.
+bool CBS::split_target(const CBSNode & node, const Collision & collision, vector<vector<Constraint>> & children) const {
+    int t = getTimestep(collision);
+    if (!isVertex(collision) || options.use_sipp || t == 0)
+        return false; // SIPP has no positive or length constraints
+    int location = getFirstPosition(collision);
+    for (int agent : { getFirstAgent(collision), getSecondAgent(collision) }) {
+        if (ins.goal_locations[agent] != location || t < (int)node.paths[agent]->size() - 1)
+            continue;
+        children = {
+            { Constraint(agent, location, LENGTH_CONSTRAINT, t) },
+            { Constraint(agent, location, POSITIVE_VERTEX_CONSTRAINT, -t) }
+        };
+        return true;
+    }
+    return false;
+}
+
+// Corridor collision: two agents meet head-on inside a chain of cells of degree two between
+// ends e1 and e2. Neither can pass the other, so one of them must be the first through.
+// With len the number of cells inside, t_a(e) a lower bound on a's arrival at e, and
+// t'_a(e) the same without entering the corridor, either
+//   a1 is not at e2 during [0, min(t'_1(e2) - 1, t_2(e1) + len)], or
+//   a2 is not at e1 during [0, min(t'_2(e1) - 1, t_1(e2) + len)]:
+// otherwise both went through the corridor in time to meet inside it.
+bool CBS::split_corridor(const CBSNode & node, const Collision & collision, vector<vector<Constraint>> & children) const {
+    auto degree = [this](int location) { return ins.get_adjacent_locations(location).size - 1; }; // minus wait
+    int location = isVertex(collision) ? getFirstPosition(collision) : getSecondPosition(collision);
+    if (degree(location) != 2)
+        return false;
+
+    // walk away from the collision both ways until the corridor ends
+    vector<int> inside = { location };
+    int ends[2] = { -1, -1 };
+    AdjacentLocations neighbours = ins.get_adjacent_locations(location);
+    int side = 0;
+    for (int next : neighbours) {
+        if (next == location)
+            continue;
+        int prev = location, curr = next;
+        while (degree(curr) == 2 && curr != location) {
+            inside.push_back(curr);
+            for (int after : ins.get_adjacent_locations(curr))
+                if (after != curr && after != prev) {
+                    prev = curr;
+                    curr = after;
+                    break;
+                }
+        }
+        if (curr == location)
+            return false; // a cycle, not a corridor
+        ends[side++] = curr;
+    }
+    if (side < 2 || ends[0] == ends[1])
+        return false;
+    auto is_inside = [&inside](int l) { return find(inside.begin(), inside.end(), l) != inside.end(); };
+    if (!isVertex(collision) && !is_inside(getFirstPosition(collision)))
+        return false;
+
+    // each agent entered from the last end it visited before the collision
+    int a[2] = { getFirstAgent(collision), getSecondAgent(collision) };
+    int entry[2];
+    for (int k = 0; k < 2; k++) {
+        const Path & path = *node.paths[a[k]];
+        entry[k] = -1;
+        for (int t = min(getTimestep(collision), (int)path.size() - 1); t >= 0 && entry[k] < 0; t--)
+            for (int e = 0; e < 2; e++)
+                if (path[t] == ends[e])
+                    entry[k] = e;
+    }
+    if (entry[0] < 0 || entry[1] < 0 || entry[0] == entry[1])
+        return false; // not head-on
+    int e1 = ends[entry[0]], e2 = ends[entry[1]]; // a1 heads from e1 to e2, a2 the other way
+    int s1 = ins.start_locations[a[0]], s2 = ins.start_locations[a[1]];
+    if (is_inside(s1) || is_inside(s2) || s1 == e2 || s2 == e1)
+        return false; // the agents must enter the corridor to get through it
+
+    int len = inside.size();
+    vector<int> from_s1 = ins.compute_distances(s1), from_s2 = ins.compute_distances(s2);
+    vector<int> around_s1 = ins.compute_distances(s1, inside), around_s2 = ins.compute_distances(s2, inside);
+    if (from_s1[e2] == MAPFInstance::UNREACHABLE || from_s2[e1] == MAPFInstance::UNREACHABLE)
+        return false;
+    int last1 = min(around_s1[e2] - 1, from_s2[e1] + len);
+    int last2 = min(around_s2[e1] - 1, from_s1[e2] + len);
+    children = { range_constraint(a[0], e2, last1), range_constraint(a[1], e1, last2) };
+    // each child must change a path, or it would split on the same collision forever
+    return invalidates(node, children[0]) && invalidates(node, children[1]);
+}
+
+// Rectangle collision: two agents on Manhattan-shortest paths cross in the rectangle
+// spanned by their starts and goals, and every pair of such paths collides in it.
+// Mirrored so that both move towards larger rows and columns, with Rs the corner nearest
+// the starts and Rg the one nearest the goals, one agent (A) enters the rectangle on the
+// row of Rs and crosses it left to right, the other (B) enters on the column of Rs and
+// crosses it bottom to top. If A reaches column Rg.x within the rectangle on time and B
+// reaches row Rg.y on time, their staircase paths share a cell, which they reach at the
+// same timestep, so one of these two barriers must hold.
+bool CBS::split_rectangle(const CBSNode & node, const Collision & collision, vector<vector<Constraint>> & children) const {
+    if (!isVertex(collision))
+        return false;
+    int a[2] = { getFirstAgent(collision), getSecondAgent(collision) };
+    int sx[2], sy[2], gx[2], gy[2];
+    for (int k = 0; k < 2; k++) {
+        int s = ins.start_locations[a[k]], g = ins.goal_locations[a[k]];
+        if ((int)node.paths[a[k]]->size() - 1 != ins.get_Manhattan_distance(s, g))
+            return false; // not a staircase path
+        sx[k] = ins.col_coordinate(s);
+        sy[k] = ins.row_coordinate(s);
+        gx[k] = ins.col_coordinate(g);
+        gy[k] = ins.row_coordinate(g);
+    }
+
+    // mirror both axes so that the agents move towards larger coordinates
+    if (sign(gx[0] - sx[0]) * sign(gx[1] - sx[1]) < 0 || sign(gy[0] - sy[0]) * sign(gy[1] - sy[1]) < 0)
+        return false;
+    int dir_x = sign(gx[0] - sx[0]) + sign(gx[1] - sx[1]) < 0 ? -1 : 1;
+    int dir_y = sign(gy[0] - sy[0]) + sign(gy[1] - sy[1]) < 0 ? -1 : 1;
+    for (int k = 0; k < 2; k++) {
+        sx[k] *= dir_x; gx[k] *= dir_x;
+        sy[k] *= dir_y; gy[k] *= dir_y;
+    }
+    int rs_x = max(sx[0], sx[1]), rs_y = max(sy[0], sy[1]);
+    int rg_x = min(gx[0], gx[1]), rg_y = min(gy[0], gy[1]);
+    int vx = ins.col_coordinate(getFirstPosition(collision)) * dir_x;
+    int vy = ins.row_coordinate(getFirstPosition(collision)) * dir_y;
+    if (rs_x >= rg_x || rs_y >= rg_y || vx < rs_x || vx > rg_x || vy < rs_y || vy > rg_y)
+        return false;
+
+    int A, B;
+    if (sy[0] == rs_y && sx[1] == rs_x)
+        A = 0, B = 1;
+    else if (sy[1] == rs_y && sx[0] == rs_x)
+        A = 1, B = 0;
+    else
+        return false;
+    if (gy[A] != rg_y || gx[B] != rg_x)
+        return false; // they do not leave through opposite sides
+    if ((rs_x - sx[A]) + (rs_y - sy[A]) != (rs_x - sx[B]) + (rs_y - sy[B]))
+        return false; // not at the rectangle at the same time
+
+    auto location = [&](int x, int y) { return ins.linearize_coordinate(y * dir_y, x * dir_x); };
+    vector<Constraint> barrier_a, barrier_b;
+    for (int y = rs_y; y <= rg_y; y++)
+        barrier_a.emplace_back(a[A], location(rg_x, y), VERTEX_CONSTRAINT, (rg_x - sx[A]) + (y - sy[A]));
+    for (int x = rs_x; x <= rg_x; x++)
+        barrier_b.emplace_back(a[B], location(x, rg_y), VERTEX_CONSTRAINT, (x - sx[B]) + (rg_y - sy[B]));
+    children = { barrier_a, barrier_b };
+    return invalidates(node, children[0]) && invalidates(node, children[1]);
+}
@@ -0,0 +1,107 @@
+#include "CBS.h"
+#include <iostream>
+#include <algorithm>
+
+// Enhanced CBS: the high level expands, among the nodes whose cost is within a factor w
+// of the smallest lower bound in open, the one with the fewest collisions. Every low-level
+// path is within w of its own lower bound, so the node with the smallest lower bound is
+// always eligible, and the solution returned costs at most w times the optimum.
+vector<Path> CBS::find_bounded_solution() {
+    double w = options.suboptimality;
+
+    auto root = new CBSNode();
+    all_nodes.push_back(root);
+
+    // plan the root agents one after another, each avoiding the paths already planned
+    root->paths.resize(ins.num_of_agents);
+    root->mdds.resize(ins.num_of_agents);
+    root->constraint_keys.resize(ins.num_of_agents, 0);
+    root->lower_bounds.resize(ins.num_of_agents);
+    ConflictAvoidanceTable root_cat(ins.map_size());
+    vector<Constraint> no_constraints;
+    for (int i = 0; i < ins.num_of_agents; i++) {
+        int agent_lower_bound;
+        Path path = a_star[0].find_bounded_path(i, no_constraints.begin(), no_constraints.end(),
+                                                w, root_cat, agent_lower_bound);
+        if (path.empty()) {
+            cout << "Fail to find a path for agent " << i << endl;
+            return vector<Path>(); // return "No solution"
+        }
+        root->cost += path.size();
+        root->lower_bounds[i] = agent_lower_bound;
+        root->lower_bound += agent_lower_bound;
+        root->paths[i] = make_shared<const Path>(move(path));
+        root_cat.add_path(*root->paths[i]);
+    }
+    find_root_collisions(*root, CollisionGrid(root->paths));
+
+    // every unexpanded node is counted in open by its lower bound, and is either
+    // in the focal heap or waiting, by cost, until the bound reaches it
+    map<int, int> open;
+    vector<CBSNode*> focal;
+    map<int, vector<CBSNode*>> waiting;
+    CompareFocalCBSNode compare;
+    double bound = w * root->lower_bound;
+    auto push = [&](CBSNode* node) {
+        open[node->lower_bound]++;
+        if (node->cost <= bound) {
+            focal.push_back(node);
+            push_heap(focal.begin(), focal.end(), compare);
+        } else {
+            waiting[node->cost].push_back(node);
+        }
+    };
+    push(root);
+
+    vector<CBSNode*> children;
+    vector<char> generated;
+    while (!focal.empty()) {
+        pop_heap(focal.begin(), focal.end(), compare);
+        CBSNode* p = focal.back();
+        focal.pop_back();
+        if (p->collisions.empty()) {
+            lower_bound = open.begin()->first;
+            return get_paths(*p);
+        }
+        auto count = open.find(p->lower_bound);
+        if (--count->second == 0)
+            open.erase(count);
+
+        CollisionGrid grid(p->paths);
+        children.clear();
+        for (const auto & constraints : split(*p, find_collision(*p))) {
+            auto q = new CBSNode(*p, constraints);
+            all_nodes.push_back(q);
+            children.push_back(q);
+        }
+        generated.assign(children.size(), 0);
+        run_tasks(pool.get(), children.size(), [&](int i, int worker) {
+            generated[i] = generate_child(*children[i], grid, worker);
+        });
+        for (size_t i = 0; i < children.size(); i++)
+            if (generated[i])
+                push(children[i]);
+
+        // lower bounds only grow from parent to child, so the bound never decreases
+        if (!open.empty() && w * open.begin()->first > bound) {
+            bound = w * open.begin()->first;
+            while (!waiting.empty() && waiting.begin()->first <= bound) {
+                for (CBSNode* node : waiting.begin()->second) {
+                    focal.push_back(node);
+                    push_heap(focal.begin(), focal.end(), compare);
+                }
+                waiting.erase(waiting.begin());
+            }
+        }
+        if (focal.empty() && !waiting.empty()) {
+            // only reachable through floating-point rounding of the bound
+            for (CBSNode* node : waiting.begin()->second) {
+                focal.push_back(node);
+                push_heap(focal.begin(), focal.end(), compare);
+            }
+            waiting.erase(waiting.begin());
+        }
+    }
+
+    return vector<Path>(); // return "No solution"
+}
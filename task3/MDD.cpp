@@ -0,0 +1,38 @@
+#include "MDD.h"
+#include <algorithm>
+
+MDD::MDD(const MAPFInstance& ins, int agent, int path_length, const ConstraintTable& constraints) {
+    int goal_location = ins.goal_locations[agent];
+    int last = path_length - 1; // timestep at which the paths reach the goal
+    levels.resize(path_length);
+
+    // forward: locations reachable at t from which the goal is still reachable by the last timestep
+    levels[0].push_back(ins.start_locations[agent]);
+    for (int t = 1; t <= last; t++) {
+        vector<int>& level = levels[t];
+        for (int location : levels[t - 1]) {
+            for (int next_location : ins.get_adjacent_locations(location)) {
+                if (ins.get_true_distance(next_location, goal_location) <= last - t
+                    && !constraints.is_constrained(location, next_location, t))
+                    level.push_back(next_location);
+            }
+        }
+        sort(level.begin(), level.end());
+        level.erase(unique(level.begin(), level.end()), level.end());
+    }
+
+    // backward: keep only locations that lead to the goal at the last timestep
+    levels[last].assign(1, goal_location);
+    for (int t = last - 1; t >= 0; t--) {
+        const vector<int>& next_level = levels[t + 1];
+        vector<int>& level = levels[t];
+        level.erase(remove_if(level.begin(), level.end(), [&](int location) {
+            for (int next_location : ins.get_adjacent_locations(location)) {
+                if (binary_search(next_level.begin(), next_level.end(), next_location)
+                    && !constraints.is_constrained(location, next_location, t + 1))
+                    return false;
+            }
+            return true;
+        }), level.end());
+    }
+}
@@ -0,0 +1,23 @@
+#pragma once
+#include "AStarPlanner.h"
+
+// Multi-valued decision diagram of an agent: levels[t] holds every location
+// the agent can occupy at timestep t on some path of a given length that
+// satisfies its constraints. A level of width one is a location that all
+// of the agent's shortest paths must visit at that timestep.
+class MDD {
+public:
+    MDD(const MAPFInstance& ins, int agent, int path_length, const ConstraintTable& constraints);
+
+    // true iff every path of the MDD is at the same location at timestep;
+    // after the last level the agent waits at its goal
+    inline bool is_singleton(int timestep) const {
+        return timestep >= (int)levels.size() || levels[timestep].size() == 1;
+    }
+
+    inline const vector<int>& get_level(int timestep) const { return levels[timestep]; }
+    inline int depth() const { return (int)levels.size(); }
+
+private:
+    vector<vector<int>> levels; // sorted locations per timestep
+};
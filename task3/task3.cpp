@@ -8,6 +8,45 @@ int main(int argc, char *argv[]) {
     MAPFInstance ins;
     string input_file = argv[1];
     string output_file = argv[2];
+    CBSOptions options;
+    for (int i = 3; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--sipp")
+            options.use_sipp = true; // use Safe Interval Path Planning as the low-level search
+        else if (option == "--threads" && i + 1 < argc)
+            options.threads = atoi(argv[++i]); // 0 uses every hardware thread
+        else if (option == "--batch" && i + 1 < argc)
+            options.batch = atoi(argv[++i]);
+        else if (option == "--heuristic" && i + 1 < argc) {
+            string heuristic = argv[++i];
+            if (heuristic == "cg")
+                options.heuristic = CG_HEURISTIC;
+            else if (heuristic == "dg")
+                options.heuristic = DG_HEURISTIC;
+            else if (heuristic == "wdg")
+                options.heuristic = WDG_HEURISTIC;
+            else if (heuristic == "none")
+                options.heuristic = NO_HEURISTIC;
+            else
+                cout << "Ignoring unknown heuristic " << heuristic << endl;
+        }
+        else if (option == "--suboptimality" && i + 1 < argc)
+            options.suboptimality = max(1.0, atof(argv[++i])); // bounded-suboptimal ECBS above 1
+        else if (option == "--no-symmetry")
+            options.symmetry_reasoning = false; // no target, corridor or rectangle reasoning
+        else if (option == "--no-disjoint")
+            options.disjoint_splitting = false; // split into two negative constraints
+        else if (option == "--no-bypass")
+            options.bypass = false; // always branch on the chosen collision
+        else if (option == "--no-cat")
+            options.avoid_conflicts = false; // break low-level ties on h only
+        else if (option == "--no-prioritize")
+            options.prioritize_collisions = false; // split on the earliest collision, as plain CBS
+        else
+            cout << "Ignoring unknown option " << option << endl;
+    }
+    if (options.threads <= 0)
+        options.threads = ThreadPool::hardware_threads();
     if (ins.load_instance(input_file)) {
         ins.print_instance();
     } else {
@@ -15,7 +54,7 @@ int main(int argc, char *argv[]) {
         exit(-1);
     }
 
-    CBS cbs(ins);
+    CBS cbs(ins, options);
     vector<Path> paths = cbs.find_solution();
     if (paths.empty()) { // Fail to find solutions
         cout << "No solutions!" << endl;
@@ -30,6 +69,12 @@ int main(int argc, char *argv[]) {
         sum += paths[i].size();
     }
     cout << "Sum of cost: " << sum << endl;
+    cout << "Heuristic tables: " << ins.heuristics_built() << " built in " << ins.heuristic_seconds() << " s" << endl;
+    if (options.suboptimality > 1.0)
+        cout << "Lower bound: " << cbs.get_lower_bound() << endl;
+#ifdef STATE_TABLE_STATS
+    cout << "State table probes: " << state_table_probes() << endl;
+#endif
 
     // save paths
     ofstream myfile (output_file.c_str(), ios_base::out);
@@ -0,0 +1,134 @@
+#include "LaCAM.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+LaCAM::LaCAM(const MAPFInstance & ins, const LaCAMOptions & options):
+        ins(ins), options(options), pibt(ins, options.seed, options.swap), random(options.seed) {}
+
+LaCAM::~LaCAM() {
+    for (HighLevelNode* node : all_nodes)
+        delete node;
+}
+
+vector<Path> LaCAM::find_solution() {
+    if (options.pibt_only)
+        return find_pibt_solution();
+    auto start = chrono::steady_clock::now();
+
+    const Config & goals = ins.goal_locations;
+    unordered_map<Config, HighLevelNode*, HashConfig> explored;
+    vector<HighLevelNode*> open; // a stack: the search is depth first
+    HighLevelNode* root = generate_node(ins.start_locations, nullptr);
+    explored[root->config] = root;
+    open.push_back(root);
+
+    Config next;
+    while (!open.empty()) {
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        if (elapsed.count() > options.time_limit)
+            break;
+
+        HighLevelNode* node = open.back();
+        if (node->config == goals) {
+            vector<Config> configs;
+            for (const HighLevelNode* n = node; n != nullptr; n = n->parent)
+                configs.push_back(n->config);
+            reverse(configs.begin(), configs.end());
+            cout << "Explored " << explored.size() << " configurations" << endl;
+            return get_paths(configs);
+        }
+        if (node->search_tree.empty()) {
+            open.pop_back(); // every successor has been generated
+            continue;
+        }
+
+        LowLevelNode constraint = move(node->search_tree.front());
+        node->search_tree.pop();
+        if (constraint.who.size() < (size_t)ins.num_of_agents) {
+            // the next time, also fix the next agent in order, to each of its moves in turn
+            int agent = node->order[constraint.who.size()];
+            AdjacentLocations moves = ins.get_adjacent_locations(node->config[agent]);
+            shuffle(moves.begin(), moves.end(), random);
+            for (int location : moves) {
+                LowLevelNode child = constraint;
+                child.who.push_back(agent);
+                child.where.push_back(location);
+                node->search_tree.push(move(child));
+            }
+        }
+
+        next.assign(ins.num_of_agents, NO_LOCATION);
+        for (size_t i = 0; i < constraint.who.size(); i++)
+            next[constraint.who[i]] = constraint.where[i];
+        if (!pibt.step(node->config, node->order, next) || explored.count(next))
+            continue;
+        HighLevelNode* child = generate_node(next, node);
+        explored[child->config] = child;
+        open.push_back(child);
+    }
+
+    return vector<Path>(); // return "No solution"
+}
+
+vector<Path> LaCAM::find_pibt_solution() {
+    auto start = chrono::steady_clock::now();
+
+    vector<Config> configs = { ins.start_locations };
+    vector<double> priorities;
+    vector<int> order;
+    prioritize(configs.back(), nullptr, priorities, order);
+    Config next;
+    while (configs.back() != ins.goal_locations) {
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        if (elapsed.count() > options.time_limit)
+            return vector<Path>(); // return "No solution"
+        next.assign(ins.num_of_agents, NO_LOCATION);
+        pibt.step(configs.back(), order, next); // cannot fail without constraints
+        configs.push_back(next);
+        vector<double> previous = move(priorities);
+        prioritize(configs.back(), &previous, priorities, order);
+    }
+    return get_paths(configs);
+}
+
+LaCAM::HighLevelNode* LaCAM::generate_node(const Config & config, const HighLevelNode* parent) {
+    auto node = new HighLevelNode();
+    all_nodes.push_back(node);
+    node->config = config;
+    node->parent = parent;
+    prioritize(config, parent ? &parent->priorities : nullptr, node->priorities, node->order);
+    node->search_tree.push(LowLevelNode()); // no agent fixed: plain PIBT
+    return node;
+}
+
+void LaCAM::prioritize(const Config & config, const vector<double>* previous,
+                       vector<double> & priorities, vector<int> & order) const {
+    int n = ins.num_of_agents;
+    priorities.resize(n);
+    for (int a = 0; a < n; a++) {
+        if (previous == nullptr) // farthest first, below 1 so that any delay outweighs it
+            priorities[a] = (double)ins.get_true_distance(config[a], ins.goal_locations[a]) / ins.map_size();
+        else if (config[a] != ins.goal_locations[a])
+            priorities[a] = (*previous)[a] + 1;
+        else
+            priorities[a] = (*previous)[a] - floor((*previous)[a]);
+    }
+    order.resize(n);
+    for (int a = 0; a < n; a++)
+        order[a] = a;
+    stable_sort(order.begin(), order.end(), [&priorities](int x, int y) { return priorities[x] > priorities[y]; });
+}
+
+vector<Path> LaCAM::get_paths(const vector<Config> & configs) const {
+    vector<Path> paths(ins.num_of_agents);
+    for (int a = 0; a < ins.num_of_agents; a++) {
+        int last = configs.size() - 1;
+        while (last > 0 && configs[last - 1][a] == ins.goal_locations[a])
+            last--; // already waiting at its goal
+        for (int t = 0; t <= last; t++)
+            paths[a].push_back(configs[t][a]);
+    }
+    return paths;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include "PIBT.h"
+#include "AStarPlanner.h"
+#include <queue>
+#include <unordered_map>
+
+struct LaCAMOptions {
+    double time_limit = 60; // seconds
+    unsigned seed = 0;
+    bool pibt_only = false; // repeat PIBT steps without search, not complete but the fastest
+    bool swap = true;       // PIBT with the swap operation of LaCAM*
+};
+
+// LaCAM: depth-first search over configurations, with PIBT generating successors lazily.
+// Each configuration keeps a queue of constraints, each fixing the next locations of
+// its first few agents in priority order; every time the configuration is visited the
+// next constraint is taken, PIBT completes it into a successor, and the constraints
+// fixing one more agent are queued. Seen configurations are never generated twice, so
+// given unbounded time the search finds a solution whenever there is one; within a time
+// limit that holds only in practice, as the configurations can be exponentially many.
+// Swaps in PIBT (see PIBT.h) keep the search from stalling in dead ends and corridors.
+class LaCAM {
+public:
+    LaCAM(const MAPFInstance& ins, const LaCAMOptions& options);
+    ~LaCAM();
+
+    // paths in the usual format, each ending at the agent's goal; empty if none was found in time
+    vector<Path> find_solution();
+
+private:
+    // next locations fixed for who[i], in priority order, to where[i]
+    struct LowLevelNode {
+        vector<int> who;
+        vector<int> where;
+    };
+
+    struct HighLevelNode {
+        Config config;
+        const HighLevelNode* parent;
+        vector<double> priorities; // grow while an agent is away from its goal
+        vector<int> order;         // agents by decreasing priority
+        queue<LowLevelNode> search_tree;
+    };
+
+    struct HashConfig {
+        size_t operator()(const Config& config) const {
+            size_t seed = config.size();
+            for (int location : config)
+                seed ^= location + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            return seed;
+        }
+    };
+
+    const MAPFInstance& ins;
+    LaCAMOptions options;
+    PIBT pibt;
+    mt19937 random;
+    vector<HighLevelNode*> all_nodes;
+
+    vector<Path> find_pibt_solution();
+    HighLevelNode* generate_node(const Config& config, const HighLevelNode* parent);
+    // priorities of config from the previous ones (nullptr at the start) and the resulting order
+    void prioritize(const Config& config, const vector<double>* previous,
+                    vector<double>& priorities, vector<int>& order) const;
+    // each agent's path ends at the last timestep it arrives at its goal
+    vector<Path> get_paths(const vector<Config>& configs) const;
+};
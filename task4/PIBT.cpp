@@ -0,0 +1,146 @@
+#include "PIBT.h"
+#include <algorithm>
+
+PIBT::PIBT(const MAPFInstance & ins, unsigned seed, bool swap):
+        ins(ins), random(seed), swap(swap), occupied_now(ins.map_size(), NO_AGENT), occupied_next(ins.map_size(), NO_AGENT) {
+    for (int a = 0; a < ins.num_of_agents; a++)
+        h_tables.push_back(&ins.get_heuristic_table(ins.goal_locations[a]));
+}
+
+bool PIBT::step(const Config & curr, const vector<int> & order, Config & next) {
+    invalid = false;
+    for (int a = 0; a < ins.num_of_agents; a++)
+        occupied_now[curr[a]] = a;
+    for (int a = 0; a < ins.num_of_agents && !invalid; a++) {
+        if (next[a] == NO_LOCATION)
+            continue;
+        if (occupied_next[next[a]] != NO_AGENT)
+            invalid = true; // two constrained agents at the same location
+        occupied_next[next[a]] = a;
+    }
+    for (int a = 0; a < ins.num_of_agents && !invalid; a++) {
+        if (next[a] == NO_LOCATION)
+            continue;
+        int other = occupied_now[next[a]];
+        if (other != NO_AGENT && other != a && next[other] == curr[a])
+            invalid = true; // two constrained agents swapping
+    }
+
+    for (int i = 0; i < (int)order.size() && !invalid; i++)
+        if (next[order[i]] == NO_LOCATION)
+            push(order[i], NO_AGENT, curr, next);
+
+    // only the locations set above are reset, so a step costs O(agents)
+    for (int a = 0; a < ins.num_of_agents; a++) {
+        occupied_now[curr[a]] = NO_AGENT;
+        if (next[a] != NO_LOCATION)
+            occupied_next[next[a]] = NO_AGENT;
+    }
+    return !invalid;
+}
+
+bool PIBT::push(int agent, int parent, const Config & curr, Config & next) {
+    // closest to the goal first, ties broken at random
+    AdjacentLocations candidates = ins.get_adjacent_locations(curr[agent]);
+    const vector<int> & h_table = *h_tables[agent];
+    shuffle(candidates.begin(), candidates.end(), random);
+    stable_sort(candidates.begin(), candidates.end(), [&h_table](int x, int y) { return h_table[x] < h_table[y]; });
+    // to swap, back off as far as possible, then pull the other agent into this location
+    int partner = swap ? swap_partner(agent, candidates.locations[0], curr, next) : NO_AGENT;
+    if (partner != NO_AGENT)
+        reverse(candidates.begin(), candidates.end());
+
+    for (int k = 0; k < candidates.size; k++) {
+        int location = candidates.locations[k];
+        if (occupied_next[location] != NO_AGENT)
+            continue; // taken
+        int other = occupied_now[location];
+        if (other != NO_AGENT && next[other] == curr[agent])
+            continue; // the two would swap, e.g. with the parent
+        next[agent] = location;
+        occupied_next[location] = agent;
+        // the agent there moves away first, or stays, and then this one tries elsewhere
+        if (other != NO_AGENT && other != agent && next[other] == NO_LOCATION && !push(other, agent, curr, next))
+            continue;
+        if (k == 0 && partner != NO_AGENT && next[partner] == NO_LOCATION && occupied_next[curr[agent]] == NO_AGENT) {
+            next[partner] = curr[agent];
+            occupied_next[curr[agent]] = partner;
+        }
+        return true;
+    }
+
+    // stay, unless the location was taken by anyone but the parent giving up on it
+    int taken = occupied_next[curr[agent]];
+    if (taken != NO_AGENT && taken != parent && taken != agent)
+        invalid = true;
+    next[agent] = curr[agent];
+    occupied_next[curr[agent]] = agent;
+    return false;
+}
+
+int PIBT::swap_partner(int agent, int best, const Config & curr, const Config & next) const {
+    if (best == curr[agent])
+        return NO_AGENT; // it would rather stay
+
+    // the agent in the way heads the other way through a dead end or corridor
+    int other = occupied_now[best];
+    if (other != NO_AGENT && next[other] == NO_LOCATION
+            && swap_required(agent, other, curr[agent], best) && swap_possible(best, curr[agent]))
+        return other;
+
+    // an agent behind would have to get past this one, which moves ahead to make room
+    for (int location : ins.get_adjacent_locations(curr[agent])) {
+        other = occupied_now[location];
+        if (location == curr[agent] || other == NO_AGENT || location == best)
+            continue;
+        if (swap_required(other, agent, curr[agent], best) && swap_possible(best, curr[agent]))
+            return other;
+    }
+    return NO_AGENT;
+}
+
+int PIBT::pull_targets(int location, int from, int & other) const {
+    int count = 0;
+    for (int next : ins.get_adjacent_locations(location)) {
+        if (next == location || next == from)
+            continue;
+        // an agent at its goal at the end of a dead end will not make room
+        int there = occupied_now[next];
+        if (ins.get_adjacent_locations(next).size == 2 && there != NO_AGENT && ins.goal_locations[there] == next)
+            continue;
+        count++;
+        other = next;
+    }
+    return count;
+}
+
+bool PIBT::swap_required(int pusher, int puller, int pusher_location, int puller_location) const {
+    const vector<int> & pusher_h = *h_tables[pusher];
+    const vector<int> & puller_h = *h_tables[puller];
+    int from = pusher_location, to = puller_location, ahead = NO_LOCATION;
+    // follow the pusher's way as long as it cannot branch off
+    while (pusher_h[to] < pusher_h[from]) {
+        int count = pull_targets(to, from, ahead);
+        if (count >= 2)
+            return false; // they can cross there without swapping
+        if (count == 0)
+            break;
+        from = to;
+        to = ahead;
+    }
+    return puller_h[from] < puller_h[to] && (pusher_h[from] == 0 || pusher_h[to] < pusher_h[from]);
+}
+
+bool PIBT::swap_possible(int pusher_location, int puller_location) const {
+    int from = pusher_location, to = puller_location, ahead = NO_LOCATION;
+    while (to != pusher_location) { // a cycle leads back without a branching cell
+        int count = pull_targets(to, from, ahead);
+        if (count >= 2)
+            return true;
+        if (count == 0)
+            return false;
+        from = to;
+        to = ahead;
+    }
+    return false;
+}
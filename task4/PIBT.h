@@ -0,0 +1,49 @@
+#pragma once
+#include "MAPFInstance.h"
+#include <random>
+
+typedef vector<int> Config; // location of every agent at one timestep
+
+constexpr int NO_AGENT = -1;
+constexpr int NO_LOCATION = -1;
+
+// Priority Inheritance with Backtracking: computes the next configuration in a single
+// step, one agent at a time in priority order. An agent moves to the free neighbour
+// closest to its goal; if a lower-priority agent stands there, that agent inherits the
+// priority and must move away first, and if it cannot, the first agent tries its next
+// candidate. The whole step costs O(agents) table lookups, whatever the number of agents.
+// With swap (from LaCAM*), an agent that must pass another one heading the opposite way
+// down a dead end or a corridor first backs off into a branching cell and pulls the other
+// agent after it, so they can cross there; plain PIBT would push each other back and forth.
+class PIBT {
+public:
+    PIBT(const MAPFInstance& ins, unsigned seed, bool swap = true);
+
+    // fill next from curr, planning the agents in order; agents whose next location is
+    // already set (not NO_LOCATION) are constrained to it. false if the constrained agents
+    // collide, or if an agent can neither move nor stay
+    bool step(const Config& curr, const vector<int>& order, Config& next);
+
+private:
+    const MAPFInstance& ins;
+    mt19937 random;
+    bool swap;
+    vector<const vector<int>*> h_tables;       // distance to the goal of every agent
+    vector<int> occupied_now, occupied_next;   // location -> agent there, NO_AGENT if none
+    bool invalid = false;
+
+    // move agent, pushed by parent (NO_AGENT at the top level); false if it has to stay
+    bool push(int agent, int parent, const Config& curr, Config& next);
+
+    // the agent to swap with when agent would move to best, NO_AGENT if no swap is needed or possible
+    int swap_partner(int agent, int best, const Config& curr, const Config& next) const;
+    // whether pusher, at pusher_location, can only get past puller, at puller_location,
+    // by swapping: the cells ahead lead nowhere else and both want to go through
+    bool swap_required(int pusher, int puller, int pusher_location, int puller_location) const;
+    // whether backing off from puller_location away from pusher_location reaches a branching
+    // cell where the two can cross
+    bool swap_possible(int pusher_location, int puller_location) const;
+    // number of neighbours of location other than from where an agent can be pulled to,
+    // and the last of them in other
+    int pull_targets(int location, int from, int& other) const;
+};
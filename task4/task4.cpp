@@ -0,0 +1,128 @@
+#include <iostream>
+#include <fstream>
+#include "MAPFInstance.h"
+#include "LaCAM.h"
+#include "ThreadPool.h"
+#include <chrono>
+
+// Solve the first step, 2 * step, ... agents of a MovingAI scenario on the map already
+// loaded into ins, until the scenario runs out, max_agents is passed or a run fails.
+// The map and the heuristic tables stay loaded across runs, so each run only computes
+// tables for goals it adds, in parallel on pool. One line per run goes to output_file: agents, sum of cost
+// and seconds spent solving, or "-1" for the sum of cost when no solution was found.
+int solve_prefixes(MAPFInstance& ins, const string& scenario_file, int step, int max_agents,
+                   const LaCAMOptions& options, ThreadPool* pool, const string& output_file) {
+    ofstream myfile (output_file.c_str(), ios_base::out);
+    if (!myfile.is_open()) {
+        cout << "Fail to save the results to " << output_file << endl;
+        return -1;
+    }
+    int previous = 0; // agents in the previous run
+    for (long long agents = step; agents <= max_agents; agents += step) {
+        if (!ins.load_scenario(scenario_file, (int)agents)) {
+            cout << "Fail to load the scenario " << scenario_file << endl;
+            return -1;
+        }
+        if (ins.num_of_agents == previous)
+            break; // the scenario has no more agents
+        previous = ins.num_of_agents;
+        auto start = chrono::steady_clock::now();
+        ins.build_heuristics(pool);
+        chrono::duration<double> bfs_time = chrono::steady_clock::now() - start;
+
+        start = chrono::steady_clock::now();
+        LaCAM lacam(ins, options);
+        vector<Path> paths = lacam.find_solution();
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+        int sum = -1;
+        if (!paths.empty()) {
+            sum = 0;
+            for (const Path& path : paths)
+                sum += path.size();
+        }
+        cout << "Agents " << ins.num_of_agents << ": sum of cost " << sum << ", " << elapsed.count()
+             << " s (heuristic tables for the new goals: " << bfs_time.count() << " s)" << endl;
+        myfile << ins.num_of_agents << " " << sum << " " << elapsed.count() << endl;
+        if (paths.empty())
+            break; // larger prefixes are no easier
+    }
+    myfile.close();
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    MAPFInstance ins;
+    string input_file = argv[1];
+    string output_file = argv[2];
+    LaCAMOptions options;
+    string scenario_file; // with a MovingAI .map as the input file
+    int agents_step = 0, max_agents = INT_MAX; // agents added per run; 0 for one run with them all
+    for (int i = 3; i < argc; i++) {
+        string option = argv[i];
+        if (option == "--scen" && i + 1 < argc)
+            scenario_file = argv[++i];
+        else if (option == "--agents-step" && i + 1 < argc)
+            agents_step = atoi(argv[++i]);
+        else if (option == "--max-agents" && i + 1 < argc)
+            max_agents = atoi(argv[++i]);
+        else if (option == "--pibt")
+            options.pibt_only = true; // PIBT steps only, without the LaCAM search
+        else if (option == "--no-swap")
+            options.swap = false; // plain PIBT, without the swap operation
+        else if (option == "--time-limit" && i + 1 < argc)
+            options.time_limit = atof(argv[++i]); // seconds
+        else if (option == "--seed" && i + 1 < argc)
+            options.seed = strtoul(argv[++i], nullptr, 10);
+        else
+            cout << "Ignoring unknown option " << option << endl;
+    }
+    // LaCAM needs the heuristic table of every agent, so they are built up front on every core
+    unique_ptr<ThreadPool> pool(new ThreadPool(ThreadPool::hardware_threads()));
+    if (!scenario_file.empty()) {
+        if (!ins.load_map(input_file)) {
+            cout << "Fail to load the map " << input_file << endl;
+            exit(-1);
+        }
+        if (agents_step <= 0)
+            agents_step = max_agents;
+        return solve_prefixes(ins, scenario_file, agents_step, max_agents, options, pool.get(), output_file);
+    }
+
+    if (ins.load_instance(input_file)) {
+        ins.print_instance();
+    } else {
+        cout << "Fail to load the instance " << input_file << endl;
+        exit(-1);
+    }
+
+    ins.build_heuristics(pool.get());
+    LaCAM lacam(ins, options);
+    vector<Path> paths = lacam.find_solution();
+    if (paths.empty()) { // Fail to find solutions
+        cout << "No solutions!" << endl;
+        return 0;
+    }
+
+    // print paths
+    cout << "Paths:" << endl;
+    int sum = 0;
+    for (int i = 0; i < ins.num_of_agents; i++) {
+        cout << "a" << i << ": " << paths[i] << endl;
+        sum += paths[i].size();
+    }
+    cout << "Sum of cost: " << sum << endl;
+    cout << "Heuristic tables: " << ins.heuristics_built() << " built in " << ins.heuristic_seconds() << " s" << endl;
+
+    // save paths
+    ofstream myfile (output_file.c_str(), ios_base::out);
+    if (myfile.is_open()) {
+        for (int i = 0; i < ins.num_of_agents; i++) {
+            myfile << paths[i] << endl;
+        }
+        myfile.close();
+    } else {
+        cout << "Fail to save the paths to " << output_file << endl;
+        exit(-1);
+    }
+    return 0;
+}